@@ -1,7 +1,7 @@
 #!/usr/bin/bash
 
 GLFW="C:/Libraries/glfw-3.3.9.bin.WIN64"
-clang main.o window.o examples/shader.o \
+clang main.o window.o cpu.o examples/shader.o \
     "$VULKAN_SDK/Lib/vulkan-1.lib" \
     "$GLFW/lib-vc2022/glfw3_mt.lib" \
     -o shader.exe
\ No newline at end of file
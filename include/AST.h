@@ -0,0 +1,281 @@
+#ifndef AST_H
+#define AST_H
+#include "Arena.h"
+#include "Casting.h"
+#include "Lexer.h"
+
+enum Primitive {
+    PRIMITIVE_UNIT,
+    PRIMITIVE_INT,
+    PRIMITIVE_BYTE,
+    PRIMITIVE_BOOL
+};
+
+enum TypeID {
+    TYPE_PRIMITIVE,
+    TYPE_POINTER,
+    TYPE_STRUCT
+};
+
+enum BinaryOperator : uint8_t {
+    BINARY_ADD,
+    BINARY_SUBTRACT,
+    BINARY_MULTIPLY,
+    BINARY_DIVIDE,
+    BINARY_REMAINDER,
+    BINARY_AND,
+    BINARY_OR,
+    BINARY_XOR,
+    BINARY_SHIFT_LEFT,
+    BINARY_SHIFT_RIGHT,
+    // comparisons, keep these together
+    BINARY_EQUAL,
+    BINARY_NOT_EQUAL,
+    BINARY_LESS,
+    BINARY_LESS_EQUAL,
+    BINARY_GREATER,
+    BINARY_GREATER_EQUAL,
+    FIRST_COMPARISON = BINARY_EQUAL
+};
+
+enum ASTKind : uint8_t {
+    AST_FUNCTION_DECLARATION,
+    AST_FUNCTION_DEFINITION,
+    AST_INCOMPLETE_STRUCT,
+    AST_IMPORT,
+    AST_VARIABLE_DEFINITION,
+    AST_WHILE_LOOP,
+    AST_RETURN,
+    // expressions, keep these together
+    AST_VARIABLE,
+    AST_INT_LITERAL,
+    AST_FLOAT_LITERAL,
+    AST_STRING_LITERAL,
+    AST_FUNCTION_CALL,
+    AST_NOT_OPERATION,
+    AST_NEGATION,
+    AST_BINARY_OPERATION,
+    FIRST_EXPRESSION = AST_VARIABLE,
+    LAST_EXPRESSION = AST_BINARY_OPERATION
+};
+
+/* Nodes are allocated in an Arena and refer to their children by plain
+    pointers. They own nothing, so the arena can drop a whole tree at once
+    without running destructors. 
+    Every node stores its kind, use isa/cast/dyn_cast or ASTVisitor rather
+    than virtual calls to find out what it is.
+    Fields marked mutable are filled in by the Analyzer after parsing, see
+    Analyzer.h. Nothing else writes to a node once it is built. */
+class AST {
+public:
+    ASTKind getKind() const { return kind; }
+protected:
+    AST(ASTKind kind);
+private:
+    const ASTKind kind;
+};
+
+class BodyAST {
+public:
+    BodyAST(ArenaArray<const AST *> statements);
+    const ArenaArray<const AST *> statements;
+};
+
+class TypeAST {
+public:
+    TypeID getTypeID() const { return typeID; }
+    mutable uint32_t resolved = 0; // index into the TypeTable
+protected:
+    TypeAST(TypeID typeID);
+private:
+    const TypeID typeID;
+};
+
+class PrimitiveTypeAST : public TypeAST {
+public:
+    PrimitiveTypeAST(Primitive primitive);
+    const Primitive primitive;
+    static bool classof(const TypeAST * type) { return type->getTypeID() == TYPE_PRIMITIVE; }
+};
+
+class PointerTypeAST : public TypeAST {
+public:
+    PointerTypeAST(const TypeAST * type);
+    const TypeAST * const type;
+    static bool classof(const TypeAST * type) { return type->getTypeID() == TYPE_POINTER; }
+};
+
+class StructTypeAST : public TypeAST {
+public:
+    StructTypeAST(Token name);
+    const Token name;
+    static bool classof(const TypeAST * type) { return type->getTypeID() == TYPE_STRUCT; }
+};
+
+
+struct Parameter {
+    Token name; // TOK_NULL if the parameter is unnamed
+    const TypeAST * type;
+};
+
+class FunctionPrototypeAST {
+public:
+    FunctionPrototypeAST(
+        Token token, 
+        ArenaArray<Parameter> parameters, 
+        const TypeAST * returnType
+    );
+    
+    const Token name;
+    const ArenaArray<Parameter> parameters;
+    const TypeAST * const returnType;
+};
+
+class FunctionDeclarationAST : public AST {
+public:
+    FunctionDeclarationAST(const FunctionPrototypeAST * prototype, bool isKernel = false);
+    const FunctionPrototypeAST * const prototype; 
+    const bool isKernel; // only kernels imported from a module interface lack a body
+    static bool classof(const AST * node) { return node->getKind() == AST_FUNCTION_DECLARATION; }
+};
+
+class FunctionDefinitionAST : public AST {
+public:
+    FunctionDefinitionAST(
+        const FunctionPrototypeAST * prototype, 
+        const BodyAST * body,
+        bool isKernel = false,
+        bool isMultiversioned = false
+    );
+    const FunctionPrototypeAST * const prototype; 
+    const BodyAST * const body;
+    const bool isKernel;
+    const bool isMultiversioned; // @multiversion, compiled once per x86-64 feature level
+    mutable uint32_t slotCount = 0; // parameters first, then every let in the body
+    static bool classof(const AST * node) { return node->getKind() == AST_FUNCTION_DEFINITION; }
+};
+
+class IncompleteStructAST : public AST {
+public:
+    IncompleteStructAST(Token name);
+    const Token name;
+    static bool classof(const AST * node) { return node->getKind() == AST_INCOMPLETE_STRUCT; }
+};
+
+class ImportAST : public AST {
+public:
+    ImportAST(Token name);
+    const Token name; // module name, its interface is name.cai
+    static bool classof(const AST * node) { return node->getKind() == AST_IMPORT; }
+};
+
+
+class ExpressionAST : public AST {
+public:
+    mutable uint32_t type = 0; // index into the TypeTable
+    static bool classof(const AST * node) {
+        return node->getKind() >= FIRST_EXPRESSION && node->getKind() <= LAST_EXPRESSION;
+    }
+protected:
+    using AST::AST;
+};
+
+class VariableAST : public ExpressionAST {
+public:
+    static constexpr uint32_t GLOBAL = UINT32_MAX;
+
+    VariableAST(Token text);
+    const Token text;
+    mutable uint32_t slot = GLOBAL; // local slot in the function, or GLOBAL for kernels
+    static bool classof(const AST * node) { return node->getKind() == AST_VARIABLE; }
+};
+
+/* Literals carry their value, folded constants have no text of their own
+    and point at the operator they replaced. */
+class IntLiteralAST : public ExpressionAST {
+public:
+    IntLiteralAST(Token text, uint32_t value);
+    const Token text;
+    const uint32_t value; // an int's bits, operations wrap around
+    static bool classof(const AST * node) { return node->getKind() == AST_INT_LITERAL; }
+};
+
+class FloatLiteralAST : public ExpressionAST {
+public:
+    FloatLiteralAST(Token text, float value);
+    const Token text;
+    const float value;
+    static bool classof(const AST * node) { return node->getKind() == AST_FLOAT_LITERAL; }
+};
+
+class StringLiteralAST : public ExpressionAST {
+public:
+    StringLiteralAST(Token text);
+    const Token text;
+    static bool classof(const AST * node) { return node->getKind() == AST_STRING_LITERAL; }
+};
+
+class FunctionCallAST : public ExpressionAST {
+public:
+    FunctionCallAST(Token token, ArenaArray<const ExpressionAST *> arguments);
+    const Token name;
+    const ArenaArray<const ExpressionAST *> arguments;
+    static bool classof(const AST * node) { return node->getKind() == AST_FUNCTION_CALL; }
+};
+
+class NotOperationAST : public ExpressionAST {
+public:
+    NotOperationAST(const ExpressionAST * expression);
+    const ExpressionAST * const expression;
+    static bool classof(const AST * node) { return node->getKind() == AST_NOT_OPERATION; }
+};
+
+class NegationAST : public ExpressionAST {
+public:
+    NegationAST(const ExpressionAST * expression);
+    const ExpressionAST * const expression;
+    static bool classof(const AST * node) { return node->getKind() == AST_NEGATION; }
+};
+
+/* The operand of a "!" or "-", nullptr for other expressions. A run of
+    prefix operators nests as deep as it is long, so passes walk it with a
+    loop rather than by recursion. */
+const ExpressionAST * prefixOperand(const ExpressionAST * expression);
+
+class BinaryOperationAST : public ExpressionAST {
+public:
+    BinaryOperationAST(BinaryOperator op, Token token, const ExpressionAST * left, const ExpressionAST * right);
+    const BinaryOperator op;
+    const Token token; // the operator, for diagnostics
+    const ExpressionAST * const left;
+    const ExpressionAST * const right;
+    bool isComparison() const { return op >= FIRST_COMPARISON; }
+    static bool classof(const AST * node) { return node->getKind() == AST_BINARY_OPERATION; }
+};
+
+class VariableDefinitionAST : public AST {
+public:
+    VariableDefinitionAST(Token name, const TypeAST * type, const ExpressionAST * expression);
+    const Token name;
+    const TypeAST * const type;
+    const ExpressionAST * const expression;
+    mutable uint32_t slot = 0;
+    static bool classof(const AST * node) { return node->getKind() == AST_VARIABLE_DEFINITION; }
+};
+
+class WhileLoopAST : public AST {
+public:
+    WhileLoopAST(const ExpressionAST * condition, const BodyAST * body);
+    const ExpressionAST * const condition;
+    const BodyAST * const body;
+    static bool classof(const AST * node) { return node->getKind() == AST_WHILE_LOOP; }
+};
+
+class ReturnAST : public AST {
+public:
+    ReturnAST(const ExpressionAST * expression);
+    const ExpressionAST * const expression;
+    static bool classof(const AST * node) { return node->getKind() == AST_RETURN; }
+};
+
+#endif // AST_H
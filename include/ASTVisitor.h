@@ -0,0 +1,98 @@
+#ifndef AST_VISITOR_H
+#define AST_VISITOR_H
+#include "AST.h"
+
+/* Dispatches on node kinds with a switch, calling Derived's visit functions
+    directly so they can be inlined. Derived only defines the functions it
+    cares about. Expressions left out fall back to visitExpression, and
+    everything else falls back to visitAST or visitType.
+
+        class Counter : public ASTVisitor<Counter, size_t> {
+        public:
+            size_t visitFunctionCall(const FunctionCallAST * call) { ... }
+            size_t visitAST(const AST * node) { return 0; }
+        };
+*/
+template<typename Derived, typename Result = void>
+class ASTVisitor {
+public:
+    Result visit(const AST * node) {
+        switch (node->getKind()) {
+        case AST_FUNCTION_DECLARATION:
+            return derived().visitFunctionDeclaration(cast<FunctionDeclarationAST>(node));
+        case AST_FUNCTION_DEFINITION:
+            return derived().visitFunctionDefinition(cast<FunctionDefinitionAST>(node));
+        case AST_INCOMPLETE_STRUCT:
+            return derived().visitIncompleteStruct(cast<IncompleteStructAST>(node));
+        case AST_IMPORT:
+            return derived().visitImport(cast<ImportAST>(node));
+        case AST_VARIABLE_DEFINITION:
+            return derived().visitVariableDefinition(cast<VariableDefinitionAST>(node));
+        case AST_WHILE_LOOP:
+            return derived().visitWhileLoop(cast<WhileLoopAST>(node));
+        case AST_RETURN:
+            return derived().visitReturn(cast<ReturnAST>(node));
+        case AST_VARIABLE:
+            return derived().visitVariable(cast<VariableAST>(node));
+        case AST_INT_LITERAL:
+            return derived().visitIntLiteral(cast<IntLiteralAST>(node));
+        case AST_FLOAT_LITERAL:
+            return derived().visitFloatLiteral(cast<FloatLiteralAST>(node));
+        case AST_STRING_LITERAL:
+            return derived().visitStringLiteral(cast<StringLiteralAST>(node));
+        case AST_FUNCTION_CALL:
+            return derived().visitFunctionCall(cast<FunctionCallAST>(node));
+        case AST_NOT_OPERATION:
+            return derived().visitNotOperation(cast<NotOperationAST>(node));
+        case AST_NEGATION:
+            return derived().visitNegation(cast<NegationAST>(node));
+        case AST_BINARY_OPERATION:
+            return derived().visitBinaryOperation(cast<BinaryOperationAST>(node));
+        }
+        assert(false);
+        return Result();
+    }
+
+    Result visit(const TypeAST * type) {
+        switch (type->getTypeID()) {
+        case TYPE_PRIMITIVE:
+            return derived().visitPrimitiveType(cast<PrimitiveTypeAST>(type));
+        case TYPE_POINTER:
+            return derived().visitPointerType(cast<PointerTypeAST>(type));
+        case TYPE_STRUCT:
+            return derived().visitStructType(cast<StructTypeAST>(type));
+        }
+        assert(false);
+        return Result();
+    }
+
+    Result visitFunctionDeclaration(const FunctionDeclarationAST * node) { return derived().visitAST(node); }
+    Result visitFunctionDefinition(const FunctionDefinitionAST * node) { return derived().visitAST(node); }
+    Result visitIncompleteStruct(const IncompleteStructAST * node) { return derived().visitAST(node); }
+    Result visitImport(const ImportAST * node) { return derived().visitAST(node); }
+    Result visitVariableDefinition(const VariableDefinitionAST * node) { return derived().visitAST(node); }
+    Result visitWhileLoop(const WhileLoopAST * node) { return derived().visitAST(node); }
+    Result visitReturn(const ReturnAST * node) { return derived().visitAST(node); }
+
+    Result visitVariable(const VariableAST * node) { return derived().visitExpression(node); }
+    Result visitIntLiteral(const IntLiteralAST * node) { return derived().visitExpression(node); }
+    Result visitFloatLiteral(const FloatLiteralAST * node) { return derived().visitExpression(node); }
+    Result visitStringLiteral(const StringLiteralAST * node) { return derived().visitExpression(node); }
+    Result visitFunctionCall(const FunctionCallAST * node) { return derived().visitExpression(node); }
+    Result visitNotOperation(const NotOperationAST * node) { return derived().visitExpression(node); }
+    Result visitNegation(const NegationAST * node) { return derived().visitExpression(node); }
+    Result visitBinaryOperation(const BinaryOperationAST * node) { return derived().visitExpression(node); }
+    Result visitExpression(const ExpressionAST * node) { return derived().visitAST(node); }
+
+    Result visitPrimitiveType(const PrimitiveTypeAST * type) { return derived().visitType(type); }
+    Result visitPointerType(const PointerTypeAST * type) { return derived().visitType(type); }
+    Result visitStructType(const StructTypeAST * type) { return derived().visitType(type); }
+
+    Result visitAST(const AST *) { return Result(); }
+    Result visitType(const TypeAST *) { return Result(); }
+
+private:
+    Derived & derived() { return *static_cast<Derived *>(this); }
+};
+
+#endif // AST_VISITOR_H
\ No newline at end of file
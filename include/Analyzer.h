@@ -0,0 +1,51 @@
+#ifndef ANALYZER_H
+#define ANALYZER_H
+#include <iostream>
+#include <vector>
+#include "Errors.h"
+#include "Program.h"
+#include "AST.h"
+#include "Interner.h"
+#include "TypeTable.h"
+
+/* Resolves names and types between parsing and code generation. Every
+    variable is bound to a slot in its function, or to a kernel, and every
+    expression and written type gets an index into the TypeTable. Code
+    generators then only index vectors and never look a name up or check a
+    type themselves.
+    Once the declarations are collected, function bodies do not depend on
+    each other, so they are checked on several threads. Kernels are only
+    checked for what the SPIRVGenerator can lower. */
+class Analyzer {
+public:
+    // Fewer function bodies than this are not worth splitting across threads.
+    static constexpr size_t MIN_CHUNK_FUNCTIONS = 256;
+
+    Analyzer(const Program & program, Interner & interner, TypeTable & types);
+    Error analyze(const std::vector<const AST *> & ast, unsigned jobs);
+
+private:
+    class FunctionChecker;
+    class KernelChecker;
+
+    const Program & program;
+    const Interner & interner;
+    TypeTable & types;
+
+    // indexed by symbol
+    std::vector<const FunctionPrototypeAST *> functions;
+    std::vector<bool> kernels;
+    std::vector<bool> incompleteStructs;
+
+    uint32_t kernelSymbol;
+    uint32_t kernelType;  // * Kernel, the value of a kernel's name
+    uint32_t stringType;  // * byte
+
+    std::vector<const FunctionDefinitionAST *> definitions;
+
+    bool resolve(const TypeAST * type);
+    bool resolve(const FunctionPrototypeAST * prototype);
+    bool resolve(const BodyAST * body);
+};
+
+#endif // ANALYZER_H
\ No newline at end of file
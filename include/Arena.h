@@ -0,0 +1,91 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* A fixed-size array living in an Arena. */
+template<typename T>
+class ArenaArray {
+public:
+    ArenaArray() : items(nullptr), count(0) {}
+    ArenaArray(T * items, uint32_t count) : items(items), count(count) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T & operator[](size_t index) const { assert(index < count); return items[index]; }
+    const T * begin() const { return items; }
+    const T * end() const { return items + count; }
+
+private:
+    T * items;
+    uint32_t count;
+};
+
+/* Bump allocator. Objects are packed into large blocks and never destroyed
+    one by one, everything is released with the arena itself. */
+class Arena {
+public:
+    Arena();
+    Arena(const Arena &) = delete;
+    Arena & operator=(const Arena &) = delete;
+
+    inline void * allocate(size_t size, size_t alignment) {
+        assert(alignment <= alignof(std::max_align_t) && (alignment & (alignment - 1)) == 0);
+        auto address = (reinterpret_cast<uintptr_t>(current) + alignment - 1) & ~(alignment - 1);
+        if (address + size > reinterpret_cast<uintptr_t>(limit)) {
+            return allocateBlock(size);
+        }
+
+        current = reinterpret_cast<char *>(address + size);
+        return reinterpret_cast<void *>(address);
+    }
+
+    template<typename T, typename... Args>
+    T * make(Args &&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /* Copies items [begin, end) of a scratch vector into the arena and
+        removes them from the vector. */
+    template<typename T>
+    ArenaArray<T> take(std::vector<T> & scratch, size_t begin) {
+        static_assert(std::is_trivially_copyable<T>::value, "arena arrays are copied bytewise");
+        assert(begin <= scratch.size());
+
+        auto count = static_cast<uint32_t>(scratch.size() - begin);
+        if (count == 0) return ArenaArray<T>();
+
+        auto items = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+        std::uninitialized_copy(scratch.begin() + begin, scratch.end(), items);
+        scratch.resize(begin);
+        return ArenaArray<T>(items, count);
+    }
+
+    /* Takes over the blocks of other, which is left empty. Objects already
+        allocated in either arena stay where they are. */
+    void adopt(Arena & other);
+
+    /* Total bytes reserved from the system. */
+    size_t capacity() const;
+
+private:
+    static constexpr size_t MIN_BLOCK_SIZE = 1 << 12;
+    static constexpr size_t MAX_BLOCK_SIZE = 1 << 20;
+
+    std::vector<std::unique_ptr<std::max_align_t[]>> blocks;
+    char * current;
+    char * limit;
+    size_t nextBlockSize;
+    size_t reserved;
+
+    void * allocateBlock(size_t size);
+};
+
+#endif // ARENA_H
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef CASTING_H
+#define CASTING_H
+#include <cassert>
+
+/* LLVM-style checked casts. To::classof(from) decides whether from is a To,
+    usually by comparing a kind tag, so no virtual call or RTTI is involved. */
+
+template<typename To, typename From>
+inline bool isa(const From * from) {
+    assert(from != nullptr);
+    return To::classof(from);
+}
+
+template<typename To, typename From>
+inline const To * cast(const From * from) {
+    assert(isa<To>(from));
+    return static_cast<const To *>(from);
+}
+
+template<typename To, typename From>
+inline const To * dyn_cast(const From * from) {
+    return isa<To>(from) ? static_cast<const To *>(from) : nullptr;
+}
+
+#endif // CASTING_H
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef CONSTANT_FOLDER_H
+#define CONSTANT_FOLDER_H
+#include "Arena.h"
+#include "AST.h"
+
+/* Collapses operators on literals into a single literal while the parser
+    builds them, much like the folder behind llvm::IRBuilder. Nodes cannot
+    change once built, so folding on construction saves a pass that would
+    have to copy every tree above a folded constant.
+    Operations that would be undefined at run time, such as division by zero
+    or shifting past the width of an int, are never folded. */
+class ConstantFolder {
+public:
+    ConstantFolder(Arena & arena);
+
+    /* Each returns the folded literal, or nullptr if it cannot fold. */
+    ExpressionAST * foldBinary(BinaryOperator op, Token token, const ExpressionAST * left, const ExpressionAST * right);
+    ExpressionAST * foldNegation(Token token, const ExpressionAST * operand);
+    ExpressionAST * foldNot(Token token, const ExpressionAST * operand);
+
+private:
+    Arena & arena;
+
+    ExpressionAST * foldInt(BinaryOperator op, Token token, uint32_t left, uint32_t right);
+    ExpressionAST * foldFloat(BinaryOperator op, Token token, float left, float right);
+};
+
+#endif // CONSTANT_FOLDER_H
\ No newline at end of file
@@ -0,0 +1,65 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+#include <memory>
+#include <string>
+#include <vector>
+#include "AST.h"
+#include "Program.h"
+
+/* A top-level fun/ker/struct/import declaration. These keywords only appear at the
+    top level, so each declaration runs from its keyword up to the next one. */
+struct Declaration {
+    size_t firstToken;
+    size_t tokenCount;
+    std::unique_ptr<Arena> arena; // holds ast, so each declaration is freed as a whole
+    const AST * ast;              // nullptr if the declaration failed to parse
+    std::string error;        // why it failed to parse
+    size_t errorOffset;       // where it failed, predating shift like the offsets in ast
+    int64_t shift;            // bytes moved by later edits, token offsets in ast predate it
+};
+
+struct EditStatistics {
+    size_t relexedTokens;
+    size_t reparsedDeclarations;
+};
+
+/* A source file open in an editor. Edits re-lex only the damaged byte range,
+    until the new tokens line up with the old ones again, and re-parse only the
+    declarations those tokens belong to. */
+class Document {
+public:
+    Document();
+    // program views text, so a Document stays where it was constructed
+    Document(const Document &) = delete;
+    Document & operator=(const Document &) = delete;
+
+    void open(std::string text);
+    /* Replaces bytes [start, end) of the text. */
+    EditStatistics edit(size_t start, size_t end, std::string_view replacement);
+
+    const Program & getProgram() const;
+    const TokenBuffer & getTokens() const;
+    const Interner & getInterner() const;
+    const std::vector<Declaration> & getDeclarations() const;
+
+    /* Why and where the text currently fails to lex, if it does. */
+    const std::string & getLexerError() const;
+    size_t getLexerErrorOffset() const;
+
+private:
+    std::string text; // std::string keeps the '\0' sentinel the lexer needs
+    std::unique_ptr<Program> program;
+    Interner interner; // kept across edits, so unchanged declarations keep their symbols
+    TokenBuffer tokens;
+    std::vector<Declaration> declarations;
+
+    std::string lexerError;
+    size_t lexerErrorOffset;
+
+    void relexAll();
+    size_t relex(size_t start, size_t end, int64_t delta, size_t * first, size_t * oldLast);
+    size_t reparse(size_t firstDeclaration, size_t lastDeclaration, size_t firstToken, size_t lastToken);
+    Declaration parseDeclaration(size_t firstToken, size_t lastToken) const;
+};
+
+#endif // DOCUMENT_H
\ No newline at end of file
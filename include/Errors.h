@@ -0,0 +1,19 @@
+#ifndef ERRORS_H
+#define ERRORS_H
+
+enum Error {
+    ERR_NONE,
+    ERR_INVALID_TOKEN,
+    ERR_INVALID_TOP_LEVEL_STATEMENT,
+    ERR_INCOMPLETE_FUNCTION_PROTOTYPE,
+    ERR_OUTPUT_OBJECT_FILE,
+    ERR_SOURCE_TOO_LARGE,
+    ERR_READ_SOURCE_FILE,
+    ERR_INVALID_MODULE_INTERFACE,
+    ERR_WRITE_MODULE_INTERFACE,
+    ERR_SEMANTIC_ANALYSIS,
+    ERR_RUN_PROGRAM,
+    ERR_LINK
+};
+
+#endif // ERRORS_H
@@ -0,0 +1,72 @@
+#ifndef IR_GENERATOR_H
+#define IR_GENERATOR_H
+#include <memory>
+#include <vector>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/IRBuilder.h>
+#include "llvm/IR/Instructions.h"
+#include "AST.h"
+#include "Interner.h"
+#include "Program.h"
+#include "TypeTable.h"
+
+class IRGenerator {
+public:
+    IRGenerator(
+        Program & program,
+        const Interner & interner,
+        const TypeTable & types,
+        llvm::LLVMContext & llvmContext,
+        llvm::Module & llvmModule
+    );
+
+    void generate(const std::vector<const AST *> & ast);
+    void generate(const std::vector<const AST *> & ast, const FunctionDefinitionAST * unit);
+    private:
+    const Program & program;
+    const Interner & interner;
+    const TypeTable & types;
+
+    llvm::LLVMContext & llvmContext;
+    llvm::Module & llvmModule;
+    std::unique_ptr<llvm::IRBuilder<>> irBuilder;
+
+    /* Names and types were resolved by the Analyzer, so nothing here looks
+        up a name. Locals live in the current function's slots. */
+    std::vector<llvm::AllocaInst *> slots;
+    std::vector<llvm::Type *> translatedTypes; // indexed by TypeTable index, nullptr until needed
+
+    // indexed by symbol
+    std::vector<llvm::Value *> globals;
+    std::vector<llvm::Function *> functions;
+    std::vector<const FunctionPrototypeAST *> prototypes; // of functions and kernels, to declare them when used
+    std::vector<bool> incompleteStructs;
+
+    struct Multiversion {
+        llvm::GlobalVariable * table;           // the version callers get, set at startup
+        std::vector<llvm::Function *> versions; // generic first, then one per feature level
+    };
+    std::vector<Multiversion> multiversions;
+    bool canMultiversion;
+
+    llvm::StructType * kernelType;
+
+    llvm::StringRef getName(const Token & token) const;
+    void prepare(const std::vector<const AST *> & ast);
+
+    llvm::Type * generate(Primitive primitive);
+    llvm::Type * translate(uint32_t type);
+    llvm::Function * generate(const FunctionPrototypeAST * prototype);
+    llvm::Function * generate(const FunctionDeclarationAST * declaration);
+    llvm::Function * generate(const FunctionDefinitionAST * definition);
+    void generateKernel(const FunctionDefinitionAST * definition);
+    void declareKernel(const FunctionPrototypeAST * prototype);
+    llvm::Function * multiversion(llvm::Function * function);
+    void generateDispatch();
+    void generate(const BodyAST * body);
+    llvm::Value * generate(const ExpressionAST * expression);
+    llvm::Value * generate(const BinaryOperationAST * operation);
+    llvm::Value * generate(const BinaryOperationAST * operation, llvm::Value * left, llvm::Value * right);
+};
+
+#endif // IR_GENERATOR_H
@@ -0,0 +1,42 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Gives every distinct identifier a dense symbol, starting from 1, so later
+    passes can index vectors by symbol instead of hashing names. Symbol 0 is
+    the empty name, which tokens other than identifiers carry. */
+class Interner {
+public:
+    static constexpr uint32_t NO_SYMBOL = 0;
+
+    Interner();
+
+    /* FNV-1a, also used to index module interfaces. */
+    static uint32_t hash(std::string_view name);
+
+    uint32_t intern(std::string_view name);
+    std::string_view name(uint32_t symbol) const;
+    /* One more than the largest symbol handed out. */
+    size_t size() const;
+
+    /* Interns every name of other, in symbol order. Returns the symbol each
+        of other's symbols became. */
+    std::vector<uint32_t> merge(const Interner & other);
+
+private:
+    struct Slot {
+        uint32_t hash;
+        uint32_t symbol; // NO_SYMBOL if the slot is empty
+    };
+
+    std::deque<std::string> names; // a deque never moves its elements
+    std::vector<Slot> slots;       // open addressing, size is a power of two
+
+    void grow();
+};
+
+#endif // INTERNER_H
\ No newline at end of file
@@ -0,0 +1,169 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "AST.h"
+#include "Errors.h"
+#include "Interner.h"
+#include "JIT.h"
+#include "Program.h"
+#include "TypeTable.h"
+
+/* Operands a, b and c are registers unless noted. Ints are kept sign
+    extended to 64 bits, arithmetic wraps at 32 bits and BC_BYTE wraps the
+    result again for bytes. Bools are 0 or 1. */
+enum BytecodeOp : uint8_t {
+    BC_INTEGER,       // a = b as a signed 32 bit immediate
+    BC_CONSTANT,      // a = constants[b], for addresses
+    BC_MOVE,          // a = b
+    BC_ADD,
+    BC_SUBTRACT,
+    BC_MULTIPLY,
+    BC_DIVIDE,
+    BC_REMAINDER,
+    BC_AND,
+    BC_OR,
+    BC_XOR,
+    BC_SHIFT_LEFT,
+    BC_SHIFT_RIGHT,
+    BC_EQUAL,
+    BC_NOT_EQUAL,
+    BC_LESS,
+    BC_LESS_EQUAL,
+    BC_GREATER,
+    BC_GREATER_EQUAL,
+    BC_NEGATE,        // a = -b
+    BC_NOT,           // a = ~b
+    BC_NOT_BOOL,      // a = !b
+    BC_BYTE,          // a = b wrapped to a signed byte
+    BC_JUMP,          // to instruction a
+    BC_JUMP_IF_FALSE, // to instruction b if a is false
+    BC_LOOP,          // back to instruction a, counts towards promotion
+    BC_CALL,          // a = functions[b](c, c + 1, ...)
+    BC_RETURN         // return a
+};
+
+struct Instruction {
+    BytecodeOp op;
+    uint32_t a, b, c;
+};
+
+/* Tier 0 of calcium --run. Every function is compiled to register
+    bytecode, which takes far less time than LLVM, and interpreted right
+    away. Calls and loop iterations heat a function up, once it is hot a
+    background thread generates the module's IR, compiles it with the JIT
+    and patches the function's native code in. Calls made after that run
+    natively, a loop that is already running stays interpreted until its
+    function is called again. */
+class Interpreter {
+public:
+    static constexpr uint32_t HOT_THRESHOLD = 1000; // calls plus loop iterations
+    static constexpr uint32_t MAX_DEPTH = 10000;    // nested interpreted calls
+    static constexpr uint32_t MAX_NATIVE_PARAMETERS = 8;
+
+    /* Where callNative's calls match the callee's convention, x86-64 (System
+        V and Windows) and AArch64 (including Apple's). Elsewhere --run uses
+        the JIT tier only. */
+#if defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__) || defined(_M_ARM64)
+    static constexpr bool SUPPORTED = true;
+#else
+    static constexpr bool SUPPORTED = false;
+#endif
+
+    Interpreter(
+        Program & program,
+        const Interner & interner,
+        const TypeTable & types,
+        const OutputOptions & options,
+        const std::vector<std::string> & libraries,
+        bool tierUp = true // false keeps every function interpreted, for --interpret
+    );
+    ~Interpreter();
+
+    // main's result is the exit code
+    Error run(const std::vector<const AST *> & ast, int * exitCode);
+private:
+    enum Width : uint8_t {
+        WIDTH_BOOL,
+        WIDTH_BYTE,
+        WIDTH_INT,
+        WIDTH_POINTER
+    };
+
+    // laid out like the runtime's Kernel, see runtime/window.h
+    struct KernelObject {
+        const uint32_t * code;
+        uint64_t size; // in words
+    };
+
+    struct Function {
+        const FunctionPrototypeAST * prototype = nullptr;
+        const FunctionDefinitionAST * definition = nullptr; // nullptr for runtime functions
+        std::vector<Instruction> code;
+        uint32_t registers = 0; // slots first, then temporaries
+        Width result = WIDTH_INT;
+        uint32_t heat = 0;
+        bool promoted = false;
+        std::atomic<void *> native{nullptr}; // set once compiled, or found in the runtime
+    };
+
+    Program & program;
+    const Interner & interner;
+    const TypeTable & types;
+    const std::vector<std::string> libraries;
+    const bool tierUp;
+    const std::vector<const AST *> * ast = nullptr;
+
+    std::deque<Function> functions;
+    std::vector<uint32_t> functionsBySymbol; // index into functions, UINT32_MAX if none
+    std::vector<uint32_t> globalsBySymbol;   // index into constants, UINT32_MAX until used
+    std::vector<int64_t> constants;
+    std::deque<std::string> strings;         // string literals, a deque never moves them
+    std::deque<std::vector<uint32_t>> kernelCode;
+    std::deque<KernelObject> kernels;
+
+    // compiling a function
+    Function * current = nullptr;
+    uint32_t temporaries = 0;
+    Error compileError = ERR_NONE;
+
+    // running
+    std::vector<int64_t> stack;
+    size_t top = 0;
+    uint32_t depth = 0;
+    bool failed = false;
+
+    // promotion, the compiler thread only starts once something gets hot
+    JIT jit;
+    std::thread compiler;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Function *> queue;
+    bool stopping = false;
+
+    std::string_view getName(const Token & token) const;
+    Width widthOf(uint32_t type) const;
+
+    Error compile(Function & function);
+    void compile(const BodyAST * body);
+    void compile(const ExpressionAST * expression, uint32_t destination);
+    void compile(const BinaryOperationAST * operation, uint32_t destination);
+    uint32_t operand(const ExpressionAST * expression);
+    uint32_t temporary();
+    uint32_t global(const VariableAST * variable);
+    size_t emit(BytecodeOp op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+
+    int64_t execute(Function & function, size_t arguments);
+    int64_t callNative(const Function & function, void * native, const int64_t * arguments);
+
+    void promote(Function & function);
+    void compileInBackground();
+};
+
+#endif // INTERPRETER_H
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef JIT_H
+#define JIT_H
+#include <memory>
+#include <string>
+#include <vector>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include "Errors.h"
+#include "Writer.h"
+
+/* Compiles a module in memory with ORC's LLJIT, for calcium --run. Code
+    targets the CPU this runs on.
+    Runtime functions (printf, createWindow, ...) are looked up in this
+    process and in the shared libraries given with --runtime, the runtime's
+    calcium_cpu_level is linked into the compiler itself. */
+class JIT {
+public:
+    JIT(const OutputOptions & options, const std::vector<std::string> & libraries);
+
+    // takes the module and runs its global constructors, only one module can be added
+    Error add(std::unique_ptr<llvm::LLVMContext> llvmContext, std::unique_ptr<llvm::Module> llvmModule);
+    // the first lookup compiles the module
+    Error lookup(const std::string & name, void ** address);
+
+    // adds the module and calls its main, whose result is the exit code
+    Error run(std::unique_ptr<llvm::LLVMContext> llvmContext, std::unique_ptr<llvm::Module> llvmModule, int * exitCode);
+private:
+    const OutputOptions options;
+    const std::vector<std::string> libraries;
+    std::unique_ptr<llvm::orc::LLJIT> jit;
+    bool compiled = false;
+};
+
+#endif // JIT_H
\ No newline at end of file
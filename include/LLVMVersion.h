@@ -0,0 +1,24 @@
+#ifndef LLVM_VERSION_H
+#define LLVM_VERSION_H
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/CodeGen.h>
+
+/* The compiler is written against LLVM 18 and still builds with LLVM 14.
+    Headers that moved in between are included from here. Other changes are
+    handled where they're used, under LLVM_VERSION_MAJOR. */
+#if LLVM_VERSION_MAJOR >= 17
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/Triple.h>
+#else
+#include <llvm/ADT/Triple.h>
+#include <llvm/Support/Host.h>
+#endif
+
+// LLVM 18 made the optimization levels a scoped enum with the same names
+#if LLVM_VERSION_MAJOR < 18
+namespace llvm {
+using CodeGenOptLevel = CodeGenOpt::Level;
+}
+#endif
+
+#endif // LLVM_VERSION_H
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef LANGUAGE_SERVER_H
+#define LANGUAGE_SERVER_H
+#include <string>
+#include <unordered_map>
+#include <llvm/Support/JSON.h>
+#include "Document.h"
+
+/* Language Server Protocol over stdin/stdout, started with "calcium --lsp".
+    Documents are kept open and updated incrementally, and parse errors are
+    published as diagnostics after every change. The time taken by each edit
+    is logged to stderr. */
+class LanguageServer {
+public:
+    int run();
+
+private:
+    std::unordered_map<std::string, Document> documents;
+    bool shuttingDown = false;
+
+    bool read(std::string * content);
+    void send(llvm::json::Value message);
+    void reply(const llvm::json::Value & id, llvm::json::Value result);
+    void notify(llvm::StringRef method, llvm::json::Value params);
+
+    void didOpen(const llvm::json::Object & params);
+    void didChange(const llvm::json::Object & params);
+    void didClose(const llvm::json::Object & params);
+    void publishDiagnostics(const std::string & uri, const Document & document);
+};
+
+#endif // LANGUAGE_SERVER_H
\ No newline at end of file
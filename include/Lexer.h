@@ -0,0 +1,141 @@
+#ifndef LEXER_H
+#define LEXER_H
+#include <iostream>
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include "Errors.h"
+#include "Interner.h"
+
+class Program;
+
+enum TokenType {
+    TOK_NULL,
+    TOK_UNIT,
+    TOK_INT,
+    TOK_BYTE,
+    TOK_BOOL,
+    TOK_STAR,
+    TOK_COLON,
+    TOK_FUN,
+    TOK_STRUCT,
+    TOK_KER,
+    TOK_IMPORT,
+    // KERNEL,
+    // VEC2,
+    // VEC4,
+    TOK_LET,
+    TOK_WHILE,
+    TOK_RETURN,
+    TOK_IDENTIFIER,
+    TOK_OPEN_PAREN,
+    TOK_CLOSE_PAREN,
+    TOK_OPEN_BRACE,
+    TOK_CLOSE_BRACE,
+    TOK_COMMA,
+    TOK_SEMICOLON,
+    TOK_AT,
+    TOK_EQUALS,
+    TOK_NOT,
+    TOK_MINUS,
+    TOK_PLUS,
+    TOK_SLASH,
+    TOK_PERCENT,
+    TOK_AMPERSAND,
+    TOK_PIPE,
+    TOK_CARET,
+    TOK_LESS,
+    TOK_GREATER,
+    TOK_LESS_EQUALS,
+    TOK_GREATER_EQUALS,
+    TOK_EQUALS_EQUALS,
+    TOK_NOT_EQUALS,
+    TOK_SHIFT_LEFT,
+    TOK_SHIFT_RIGHT,
+    TOK_FLOAT_LITERAL,
+    TOK_INT_LITERAL,
+    TOK_STRING_LITERAL,
+    TOK_EOF
+};
+
+struct Token {
+    Token();
+    Token(TokenType type, uint32_t offset, uint32_t length, uint32_t symbol = Interner::NO_SYMBOL);
+    TokenType type;
+    uint32_t offset; // byte offset into the program text
+    uint32_t length;
+    uint32_t symbol; // interned name, for identifiers
+};
+
+/* Token storage as a structure of arrays. Types are packed into bytes since
+    the parser looks at them far more often than at offsets or lengths. */
+class TokenBuffer {
+public:
+    size_t size() const;
+    Token operator[](size_t index) const;
+    TokenType type(size_t index) const;
+
+    void push(TokenType type, uint32_t offset, uint32_t length, uint32_t symbol);
+    void reserve(size_t capacity);
+    void resize(size_t count);
+
+    /* Overwrites tokens from begin onwards with all of source. */
+    void write(size_t begin, const TokenBuffer & source);
+    /* Replaces every symbol s with mapping[s], see Interner::merge. */
+    void renumber(const std::vector<uint32_t> & mapping);
+
+    /* Replaces tokens [begin, end) with all of replacement. */
+    void replace(size_t begin, size_t end, const TokenBuffer & replacement);
+    /* Moves the offsets of tokens from begin onwards by delta bytes. */
+    void shift(size_t begin, int64_t delta);
+private:
+    std::vector<uint8_t> types;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> symbols;
+};
+
+class Lexer {
+public:
+    // Programs smaller than this are not worth splitting across threads.
+    static constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    /* Errors are written to diagnostics. */
+    Lexer(const Program & program, Interner & interner, std::ostream & diagnostics = std::cerr);
+
+    /* Reads the whole program. */
+    Error tokenize(TokenBuffer & tokens);
+    /* Reads the whole program, splitting it into chunks lexed on up to jobs
+        threads. The tokens and errors are the same as when lexing serially. */
+    Error tokenize(TokenBuffer & tokens, unsigned jobs);
+    /* Reads one token, yielding TOK_EOF once the program is exhausted. */
+    Error next(Token * token);
+    /* Continues lexing from index, which must not be inside a token or comment. */
+    void seek(size_t index);
+
+    /* Where the last invalid token starts, as a byte offset. */
+    size_t getErrorOffset() const;
+
+private:
+    const Program & program;
+    Interner & interner;
+    std::ostream & diagnostics;
+    const std::string_view text; // followed by a '\0' sentinel
+    size_t index;
+    size_t errorOffset;
+
+    bool eof() const;
+    char get() const;
+
+    void skipWhitespace();
+    Error tokenizeUntil(size_t limit, TokenBuffer & tokens);
+
+    TokenType readToken();
+    uint32_t intern(TokenType type, size_t startIndex);
+    TokenType readIdentifier();
+    TokenType readNumberLiteral();
+    TokenType readStringLiteral();
+    TokenType readPunctuation();
+};
+
+#endif // LEXER_H
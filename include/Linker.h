@@ -0,0 +1,32 @@
+#ifndef LINKER_H
+#define LINKER_H
+#include <string>
+#include <vector>
+#include "LLVMVersion.h"
+#include "Errors.h"
+
+/* Links objects into an executable with LLD inside this process, for
+    calcium -o. Programs are linked against the runtime archive built next
+    to the compiler (see CalciumRuntime in CMakeLists.txt), the libraries it
+    needs, the libraries given with --runtime and the C++ standard library.
+    Unused sections are dropped, see OutputOptions::functionSections.
+    Only ELF with glibc and COFF (Windows) are supported. */
+class Linker {
+public:
+    Linker(const std::vector<std::string> & libraries);
+    /* Whether this build can link for the default triple, i.e. it has LLD
+        and the target is ELF or COFF. Says why not, so -o can fail before
+        anything is compiled. */
+    static bool available();
+    Error link(const std::vector<std::string> & objects, const std::string & filename);
+private:
+    const llvm::Triple triple;
+    std::vector<std::string> libraries; // linked after the objects, in order
+
+    Error elfArguments(const std::vector<std::string> & objects, const std::string & filename, std::vector<std::string> * arguments) const;
+    void coffArguments(const std::vector<std::string> & objects, const std::string & filename, std::vector<std::string> * arguments) const;
+    // startup files, e.g. crt1.o, are looked up in the C++ compiler's library directories
+    Error findStartupFile(const std::string & name, std::string * path) const;
+};
+
+#endif // LINKER_H
\ No newline at end of file
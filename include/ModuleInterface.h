@@ -0,0 +1,55 @@
+#ifndef MODULE_INTERFACE_H
+#define MODULE_INTERFACE_H
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Errors.h"
+#include "Arena.h"
+#include "AST.h"
+#include "Interner.h"
+#include "SourceBuffer.h"
+
+/* The declarations a module exports, function and kernel prototypes and
+    struct names, in a compact binary file (name.cai) that is written next to
+    the module's object file.
+
+    The file starts with a hash table from names to declaration records, so an
+    importer maps it and decodes only the declarations its program refers to,
+    without ever lexing or parsing the module. 
+
+    Layout, integers are native endian and lengths are LEB128 varints:
+        "CAI" version:u8  declarationCount:u32  tableSize:u32
+        table:u32[tableSize]  offset of each record, 0 if the slot is empty
+        records           kind:u8  name  [parameterCount  types...  returnType]
+    A type is a primitive, TYPE_TAG_POINTER followed by a type, or
+    TYPE_TAG_STRUCT followed by a name. */
+class ModuleInterface {
+public:
+    ModuleInterface() = default;
+    ModuleInterface(const ModuleInterface &) = delete;
+    ModuleInterface & operator=(const ModuleInterface &) = delete;
+
+    /* Writes every top-level declaration of a parsed module. */
+    static Error write(const std::string & filename, const Interner & interner, const std::vector<const AST *> & ast);
+
+    /* Replaces the imports in ast with the imported declarations the program
+        refers to, ahead of its own declarations. Interfaces are read from
+        directory. Names are looked up once per symbol of the program, so the
+        cost does not depend on the size of the imported modules. */
+    static Error resolve(
+        const std::string & directory, Interner & interner, 
+        Arena & arena, std::vector<const AST *> & ast
+    );
+
+    Error open(const std::string & filename);
+    /* Decodes the declaration called name into arena and interns the names
+        it uses. Sets declaration to nullptr if the module has none. */
+    Error load(std::string_view name, Interner & interner, Arena & arena, const AST ** declaration) const;
+
+private:
+    std::string filename;
+    SourceBuffer file;
+    uint32_t tableSize = 0;
+};
+
+#endif // MODULE_INTERFACE_H
\ No newline at end of file
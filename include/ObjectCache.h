@@ -0,0 +1,52 @@
+#ifndef OBJECT_CACHE_H
+#define OBJECT_CACHE_H
+#include <string>
+#include <vector>
+#include "AST.h"
+#include "Errors.h"
+#include "Interner.h"
+#include "Program.h"
+#include "TypeTable.h"
+#include "Writer.h"
+
+/* Content-addressed cache of compiled definitions, for --cache <dir>.
+    Every function and kernel is compiled to an object of its own, named by
+    a hash of its resolved AST, the signatures of whatever it calls, the
+    target and the options. After a small edit only the definitions whose
+    hash changed go through the IRGenerator and LLVM again.
+    Nothing is ever removed, delete the directory to empty it. */
+class ObjectCache {
+public:
+    static constexpr uint32_t VERSION = 1; // bump whenever the same key would compile differently
+
+    ObjectCache(
+        Program & program,
+        const Interner & interner,
+        const TypeTable & types,
+        const OutputOptions & options,
+        const std::string & directory
+    );
+
+    /* Compiles whatever is missing on up to jobs threads. Objects come out
+        in definition order, compiled counts the ones that were missing. */
+    Error build(const std::vector<const AST *> & ast, unsigned jobs, std::vector<std::string> * objects, size_t * compiled);
+
+    // one quoted object per line, for the linker, e.g. clang @main.rsp
+    static Error writeResponseFile(const std::string & filename, const std::vector<std::string> & objects);
+
+private:
+    class KeyBuilder;
+
+    Program & program;
+    const Interner & interner;
+    const TypeTable & types;
+    const OutputOptions options;
+    const std::string directory;
+
+    std::vector<const FunctionPrototypeAST *> prototypes; // indexed by symbol
+
+    std::string key(const FunctionDefinitionAST * definition) const;
+    Error compile(const std::vector<const AST *> & ast, const FunctionDefinitionAST * definition, const std::string & path) const;
+};
+
+#endif // OBJECT_CACHE_H
\ No newline at end of file
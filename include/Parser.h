@@ -0,0 +1,123 @@
+#ifndef PARSER_H
+#define PARSER_H
+#include <iostream>
+#include <vector>
+#include <sstream>
+#include "Errors.h"
+#include "Program.h"
+#include "TokenStream.h"
+#include "Arena.h"
+#include "AST.h"
+#include "ConstantFolder.h"
+
+struct ParserError {
+    Token token;
+    std::stringstream message;
+    bool empty();
+};
+
+class Parser {
+public:
+    // Token buffers shorter than this are not worth splitting across threads.
+    static constexpr size_t MIN_CHUNK_TOKENS = 1 << 16;
+    // Bodies, parentheses and call arguments nest by recursion here and in
+    // later passes, so their depth is bounded.
+    static constexpr size_t MAX_NESTING_DEPTH = 256;
+
+    /* Nodes are allocated in arena, which must outlive the tree. Errors are
+        written to diagnostics. */
+    Parser(const Program & program, TokenStream & tokens, Arena & arena, std::ostream & diagnostics = std::cerr);
+    Error parse(std::vector<const AST *> & ast);
+
+    /* Parses a whole token buffer, splitting it at top-level declarations
+        into chunks parsed on up to jobs threads. The tree and errors are the
+        same as when parsing serially. */
+    static Error parse(
+        const Program & program, const TokenBuffer & tokens, unsigned jobs,
+        Arena & arena, std::vector<const AST *> & ast, std::ostream & diagnostics = std::cerr
+    );
+
+    /* Where and why the last parse failed, for callers placing the error
+        themselves rather than reading the diagnostics. */
+    size_t getErrorOffset() const;
+    const std::string & getErrorMessage() const;
+
+    bool eof();
+    Token get();
+private:
+    const Program & program;
+    TokenStream & tokens;
+    size_t index; // current position in the token list
+    size_t depth; // current nesting, see MAX_NESTING_DEPTH
+    Arena & arena;
+    std::ostream & diagnostics;
+    ConstantFolder folder;
+
+    // lists are collected here, then copied into the arena once complete
+    std::vector<const AST *> statementScratch;
+    std::vector<const ExpressionAST *> expressionScratch;
+    std::vector<Parameter> parameterScratch;
+    std::vector<Token> prefixScratch;
+
+    ParserError error;
+    size_t errorOffset; // byte offset into the program
+    std::string errorMessage;
+
+    /* Returns true if it finds the expected syntax, advances the index.
+        Every choice is made from the next one or two tokens, so nothing is
+        ever parsed twice. A failure ends the parse where it happened. */
+    bool expect(TokenType tokenType);
+    bool expectIdentifier(Token * token);
+    bool expectType(const TypeAST ** type);
+    bool expectExpression(const ExpressionAST ** expression);
+
+    bool parseFunction(const AST ** statement);
+    bool parseAttribute(bool * isMultiversioned);
+    bool parseStruct(const AST ** statement);
+    bool parseImport(const AST ** statement);
+
+    /* On failure, these functions return nullptr or false. */
+    BodyAST * parseBody();
+    bool parseStatementList(ArenaArray<const AST *> * statements);
+    const AST * parseStatement();
+    VariableDefinitionAST * parseVariableDefinition();
+    ReturnAST * parseReturn();
+    WhileLoopAST * parseWhileLoop();
+    const ExpressionAST * parseExpression();
+    const ExpressionAST * parseBinaryOperation(int precedence);
+    const ExpressionAST * parseUnaryExpression();
+    const ExpressionAST * parsePrimaryExpression();
+    const ExpressionAST * parseParenthesized();
+    IntLiteralAST * parseIntLiteral(bool isNegated = false);
+    FloatLiteralAST * parseFloatLiteral();
+    FunctionCallAST * parseFunctionCall();
+    bool parseExpressionList(ArenaArray<const ExpressionAST *> * expressions);
+
+    TypeAST * parseType(); 
+    FunctionPrototypeAST * parseFunctionPrototype(bool isKernel = false);
+    bool parseParameterList(ArenaArray<Parameter> * parameters);
+    bool parseParameter(Token * name, const TypeAST ** type);
+
+    /* Enters one more level of nesting, or fails if that is too deep. */
+    bool enter();
+    void leave();
+
+    static bool isStatementStart(TokenType type);
+    static bool isExpressionStart(TokenType type);
+    /* Higher binds tighter, 0 if the token is not a binary operator. */
+    static int binaryPrecedence(TokenType type, BinaryOperator * op);
+
+    template<typename T, TokenType tokenType>
+    T * parseToken() {
+        if (eof()) return nullptr;
+
+        Token tok = get();
+        if (tok.type == tokenType) {
+            index++;
+            return arena.make<T>(tok);
+        }
+        return nullptr;
+    }
+};
+
+#endif // PARSER_H
\ No newline at end of file
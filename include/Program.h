@@ -0,0 +1,35 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+#include <mutex>
+#include <string_view>
+#include "Lexer.h"
+
+struct SourceLocation {
+    size_t line;
+    size_t column;
+};
+
+class Program {
+public:
+    /* The text must be followed by a '\0' sentinel, see SourceBuffer. */
+    Program(std::string_view text); 
+    std::string_view source() const;
+    std::string_view extract(const Token & token) const;
+
+    /* Line and column are only needed for diagnostics, so the table of
+        line start offsets is built the first time one is requested. Safe to
+        call from several threads at once. */
+    SourceLocation locate(size_t offset) const;
+    SourceLocation locate(const Token & token) const;
+    /* Inverse of locate, clamped to the end of the line and the text. */
+    size_t offset(SourceLocation location) const;
+
+private:
+    const std::string_view text;
+    mutable std::vector<size_t> lineStarts;
+    mutable std::once_flag lineStartsBuilt;
+
+    void buildLineStarts() const;
+};
+
+#endif // PROGRAM_H
\ No newline at end of file
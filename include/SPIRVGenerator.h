@@ -1,5 +1,6 @@
 #ifndef SPIRV_GENERATOR_H
 #define SPIRV_GENERATOR_H
+#include <cstring>
 #include <vector>
 #include <variant>
 #include "Program.h"
@@ -23,6 +24,13 @@ enum OpCode {
     OP_STORE = 62,
     OP_DECORATE = 71,
     OP_COMPOSITE_CONSTRUCT = 80,
+    OP_F_NEGATE = 127,
+    OP_F_ADD = 129,
+    OP_F_SUB = 131,
+    OP_F_MUL = 133,
+    OP_F_DIV = 136,
+    OP_F_REM = 140,
+    OP_VECTOR_TIMES_SCALAR = 142,
     OP_LABEL = 248,
     OP_RETURN = 253
 };
@@ -49,10 +57,17 @@ private:
     spirv_id floatType;
     spirv_id vec4Type;
 
-    void generate(const std::unique_ptr<BodyAST> & body);
-    spirv_id generate(const std::unique_ptr<ExpressionAST> & body);
+    // result type of each id, 0 if it has none
+    std::vector<spirv_id> types;
+
+    void generate(const BodyAST * body);
+    spirv_id generate(const ExpressionAST * expression);
+    spirv_id generate(const BinaryOperationAST * operation);
+    spirv_id generate(const BinaryOperationAST * operation, spirv_id left, spirv_id right);
 
     spirv_id requestId();
+    spirv_id setType(spirv_id id, spirv_id type);
+    spirv_id typeOf(spirv_id id) const;
 
     template<OpCode opcode>
     inline std::vector<uint32_t> & section() {
@@ -61,6 +76,8 @@ private:
             return constantSection;
         case OP_FUNCTION: case OP_FUNCTION_END: case OP_STORE:
         case OP_COMPOSITE_CONSTRUCT: case OP_LABEL: case OP_RETURN: 
+        case OP_F_NEGATE: case OP_F_ADD: case OP_F_SUB: case OP_F_MUL:
+        case OP_F_DIV: case OP_F_REM: case OP_VECTOR_TIMES_SCALAR:
             return codeSection;
         default: 
             return headerSection;
@@ -0,0 +1,33 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+#include <cstddef>
+
+/* Bulk scanning routines used by the lexer. Each one scans [begin, end) and
+    returns a pointer to the first byte that stops the scan, or end.
+    The widest kernel the host supports (AVX2, SSE2 or scalar) is picked once
+    at startup. */
+
+// Skips ' ', '\t', '\n', '\v', '\f' and '\r'.
+const char * scanWhitespace(const char * begin, const char * end);
+
+// Finds the next '\n', used to skip line comments.
+const char * scanNewline(const char * begin, const char * end);
+
+// Finds the next '"' or '\n', used to close string literals.
+const char * scanQuoteOrNewline(const char * begin, const char * end);
+
+// Skips ASCII letters and digits, used to read identifiers.
+const char * scanAlphanumeric(const char * begin, const char * end);
+
+enum ScannerWidth {
+    SCANNER_SCALAR,
+    SCANNER_SSE2,
+    SCANNER_AVX2
+};
+
+/* Switches every scan to the given kernels, or returns false if the host
+    lacks them. For benchmarks comparing the kernels, must not be called while
+    anything is being lexed. */
+bool selectScanner(ScannerWidth width);
+
+#endif // SCANNER_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef SCOPED_SYMBOL_TABLE_H
+#define SCOPED_SYMBOL_TABLE_H
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/* Binds symbols to values, such as local slots, across nested scopes.
+    Looking a name up is a single index by symbol. Declaring a name saves
+    the binding it hides in one flat list, and leaving a scope restores
+    whatever was saved since the scope was entered, so entering and leaving
+    cost nothing beyond the names declared in between. */
+class ScopedSymbolTable {
+public:
+    static constexpr uint32_t UNBOUND = UINT32_MAX;
+
+    ScopedSymbolTable(size_t symbolCount) : bindings(symbolCount, UNBOUND) {}
+
+    uint32_t lookup(uint32_t symbol) const {
+        assert(symbol < bindings.size());
+        return bindings[symbol];
+    }
+
+    void declare(uint32_t symbol, uint32_t value) {
+        assert(symbol < bindings.size() && !scopes.empty());
+        shadowed.push_back({ symbol, bindings[symbol] });
+        bindings[symbol] = value;
+    }
+
+    void enter() {
+        scopes.push_back(shadowed.size());
+    }
+
+    void leave() {
+        assert(!scopes.empty());
+        for (size_t i = shadowed.size(); i > scopes.back(); i--) {
+            bindings[shadowed[i - 1].symbol] = shadowed[i - 1].binding;
+        }
+        shadowed.resize(scopes.back());
+        scopes.pop_back();
+    }
+
+    size_t depth() const { return scopes.size(); }
+
+private:
+    struct Shadowed {
+        uint32_t symbol;
+        uint32_t binding;
+    };
+
+    std::vector<uint32_t> bindings;  // indexed by symbol
+    std::vector<Shadowed> shadowed;  // innermost last
+    std::vector<size_t> scopes;      // size of shadowed when each scope was entered
+};
+
+#endif // SCOPED_SYMBOL_TABLE_H
\ No newline at end of file
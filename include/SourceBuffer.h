@@ -0,0 +1,33 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+#include <memory>
+#include <string>
+#include <string_view>
+#include "Errors.h"
+
+/* Read-only contents of a source file. Files are memory mapped when the
+    mapping leaves room for a terminating '\0' in the last page, otherwise
+    they are read into a padded buffer. Either way text() is followed by a
+    '\0' sentinel, so the lexer can look one byte past the end. */
+class SourceBuffer {
+public:
+    SourceBuffer() = default;
+    ~SourceBuffer();
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer & operator=(const SourceBuffer &) = delete;
+
+    Error open(const std::string & filename);
+    std::string_view text() const;
+
+private:
+    const char * data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::unique_ptr<char[]> buffer;
+
+    bool map(const std::string & filename);
+    bool read(const std::string & filename);
+    void close();
+};
+
+#endif // SOURCE_BUFFER_H
\ No newline at end of file
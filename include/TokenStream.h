@@ -0,0 +1,43 @@
+#ifndef TOKEN_STREAM_H
+#define TOKEN_STREAM_H
+#include <vector>
+#include "Lexer.h"
+
+/* Tokens as seen by the parser. The lexer is pulled on demand and tokens are
+    kept in a fixed-size ring buffer, so lexing and parsing interleave and token
+    memory is bounded by the window rather than by the size of the program. 
+    A stream can also read a range of an already lexed TokenBuffer. */
+class TokenStream {
+public:
+    // Must be a power of two. The parser may look back or ahead this many
+    // tokens from the furthest token lexed so far.
+    static constexpr size_t WINDOW = 1 << 16;
+
+    TokenStream(Lexer & lexer);
+    TokenStream(const TokenBuffer & tokens, size_t begin, size_t end);
+
+    TokenType type(size_t index);
+    Token get(size_t index);
+
+    /* Set once the lexer fails, after which the stream reads as TOK_EOF. */
+    Error error() const;
+
+private:
+    Lexer * lexer;
+    const TokenBuffer * buffer;
+    size_t begin; // range of the buffer, when reading one
+    size_t end;
+
+    std::vector<uint8_t> types;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> symbols;
+
+    size_t lexed; // number of tokens pulled from the lexer so far
+    Token last;   // TOK_EOF, once reached
+    Error err;
+
+    bool fill(size_t index);
+};
+
+#endif // TOKEN_STREAM_H
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef TYPE_TABLE_H
+#define TYPE_TABLE_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AST.h"
+#include "Interner.h"
+
+/* Types after semantic analysis, each one a dense index. Equal types share
+    an index, so comparing two types is comparing two integers and a code
+    generator can translate every type once and keep it in a vector.
+    Only the Analyzer adds types, code generators just read them. */
+class TypeTable {
+public:
+    static constexpr uint32_t NO_TYPE = 0; // an expression that failed to check
+
+    TypeTable();
+
+    static constexpr uint32_t primitive(Primitive primitive) { return primitive + 1; }
+    uint32_t pointer(uint32_t pointee);
+    uint32_t structure(uint32_t symbol);
+
+    TypeID id(uint32_t type) const;
+    bool isPrimitive(uint32_t type, Primitive primitive) const;
+    Primitive primitiveOf(uint32_t type) const;
+    uint32_t pointee(uint32_t type) const;
+    uint32_t symbol(uint32_t type) const;
+    size_t size() const;
+
+    /* Spells the type the way it is written, for diagnostics. */
+    std::string name(uint32_t type, const Interner & interner) const;
+
+private:
+    struct Entry {
+        TypeID id;
+        uint32_t operand; // the primitive, the pointee or the struct's symbol
+        uint32_t pointer; // pointer to this type, NO_TYPE until requested
+    };
+
+    std::vector<Entry> types;
+    std::vector<uint32_t> structs; // indexed by symbol
+};
+
+#endif // TYPE_TABLE_H
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef WRITER_H
+#define WRITER_H
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+#include "Errors.h"
+
+enum Optimization {
+    OPTIMIZE_NONE,      // -O0
+    OPTIMIZE_LESS,      // -O1
+    OPTIMIZE_DEFAULT,   // -O2
+    OPTIMIZE_AGGRESSIVE,// -O3
+    OPTIMIZE_SIZE       // -Os
+};
+
+/* How the object file is generated, set from the command line. */
+struct OutputOptions {
+    Optimization optimization = OPTIMIZE_NONE;
+    // print the time spent in every optimization and code generation pass
+    bool timePasses = false;
+    std::string cpu = "generic";  // -mcpu, or the host's with -march=native
+    std::string features;         // -mattr, e.g. "+avx2,-fma"
+    // a section per function and global, so the linker can drop unused ones
+    bool functionSections = false;
+    // --emit-llvm, write the optimized module as text instead of an object
+    bool emitLLVM = false;
+
+    /* Targets the CPU this runs on, with every feature it has. Features
+        already set are kept after the host's, so they take precedence. */
+    void targetHost();
+};
+
+class Writer {
+public:
+    Writer(llvm::Module & llvmModule, const OutputOptions & options = OutputOptions());
+    Error output(const std::string & filename);
+    /* Splits the module into one partition per file, each optimized and
+        compiled on its own thread. */
+    Error output(const std::vector<std::string> & filenames);
+
+    /* Tags every function with the machine's CPU and features and runs the
+        optimization pipeline, the JIT does the same before compiling. */
+    static void optimize(llvm::Module & llvmModule, llvm::TargetMachine & targetMachine, const OutputOptions & options);
+private:
+    llvm::Module & llvmModule;
+    const OutputOptions options;
+    const llvm::Target * target = nullptr;
+    std::string targetTriple;
+    std::unique_ptr<llvm::TargetMachine> targetMachine;
+
+    // a target machine can only compile one module at a time
+    llvm::TargetMachine * createTargetMachine() const;
+    static Error emit(llvm::Module & llvmModule, llvm::TargetMachine & targetMachine, const OutputOptions & options, const std::string & filename);
+};
+
+#endif // WRITER_H
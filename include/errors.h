@@ -1,12 +0,0 @@
-#ifndef ERRORS_H
-#define ERRORS_H
-
-enum Error {
-    ERR_NONE,
-    ERR_INVALID_TOKEN,
-    ERR_INVALID_TOP_LEVEL_STATEMENT,
-    ERR_INCOMPLETE_FUNCTION_PROTOTYPE,
-    ERR_OUTPUT_OBJECT_FILE
-};
-
-#endif // ERRORS_H
@@ -0,0 +1,91 @@
+/**
+ * Host CPU detection for functions marked @multiversion. The compiler
+ * emits a constructor that calls calcium_cpu_level once at startup and
+ * points every multiversioned function at the best version it has.
+*/
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+
+struct Registers {
+    uint32_t eax, ebx, ecx, edx;
+};
+
+static Registers cpuid(uint32_t leaf, uint32_t subleaf = 0) {
+    Registers r;
+#if defined(_MSC_VER)
+    int values[4];
+    __cpuidex(values, leaf, subleaf);
+    r = { uint32_t(values[0]), uint32_t(values[1]), uint32_t(values[2]), uint32_t(values[3]) };
+#else
+    __cpuid_count(leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+#endif
+    return r;
+}
+
+// which register states the OS saves on a context switch
+static uint64_t xgetbv() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (uint64_t(edx) << 32) | eax;
+#endif
+}
+
+static bool has(uint32_t bits, uint32_t mask) {
+    return (bits & mask) == mask;
+}
+
+/**
+ * The x86-64 microarchitecture level of this CPU, matching the versions
+ * the compiler emits: 0 for the baseline, 1 for x86-64-v2 (SSE4.2),
+ * 2 for x86-64-v3 (AVX2) and 3 for x86-64-v4 (AVX-512).
+*/
+extern "C" int calcium_cpu_level() {
+    uint32_t maxLeaf = cpuid(0).eax;
+    uint32_t maxExtendedLeaf = cpuid(0x80000000).eax;
+
+    // leaves past the maximum return garbage, treat them as all zero
+    Registers none = { 0, 0, 0, 0 };
+    auto basic = maxLeaf >= 1 ? cpuid(1) : none;
+    auto extended = maxLeaf >= 7 ? cpuid(7) : none;
+    auto amd = maxExtendedLeaf >= 0x80000001 ? cpuid(0x80000001) : none;
+
+    // SSE3, SSSE3, CMPXCHG16B, SSE4.1, SSE4.2, POPCNT and LAHF
+    bool v2 = has(basic.ecx, (1u << 0) | (1u << 9) | (1u << 13) | (1u << 19) | (1u << 20) | (1u << 23)) &&
+        has(amd.ecx, 1u << 0);
+    if (!v2) return 0;
+
+    // AVX registers are only usable when the OS saves them
+    bool osxsave = has(basic.ecx, 1u << 27);
+    uint64_t xcr0 = osxsave ? xgetbv() : 0;
+
+    // AVX, AVX2, BMI1, BMI2, F16C, FMA, LZCNT and MOVBE
+    bool v3 = has(xcr0, 0x6) &&
+        has(basic.ecx, (1u << 12) | (1u << 22) | (1u << 28) | (1u << 29)) &&
+        has(extended.ebx, (1u << 3) | (1u << 5) | (1u << 8)) &&
+        has(amd.ecx, 1u << 5);
+    if (!v3) return 1;
+
+    // AVX512F, AVX512DQ, AVX512CD, AVX512BW and AVX512VL
+    bool v4 = has(xcr0, 0xE6) &&
+        has(extended.ebx, (1u << 16) | (1u << 17) | (1u << 28) | (1u << 30) | (1u << 31));
+    return v4 ? 3 : 2;
+}
+
+#else
+
+extern "C" int calcium_cpu_level() {
+    return 0;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,641 @@
+#include "../include/Analyzer.h"
+#include "../include/ASTVisitor.h"
+#include "../include/ScopedSymbolTable.h"
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+static constexpr uint32_t NO_TYPE = TypeTable::NO_TYPE;
+static constexpr uint32_t INT_TYPE = TypeTable::primitive(PRIMITIVE_INT);
+static constexpr uint32_t BYTE_TYPE = TypeTable::primitive(PRIMITIVE_BYTE);
+static constexpr uint32_t BOOL_TYPE = TypeTable::primitive(PRIMITIVE_BOOL);
+
+static bool isInteger(uint32_t type) {
+    return type == INT_TYPE || type == BYTE_TYPE;
+}
+
+// the token diagnostics point at, operators without one point at their operand
+static Token tokenOf(const ExpressionAST * expression) {
+    while (true) {
+        switch (expression->getKind()) {
+        case AST_VARIABLE:        return cast<VariableAST>(expression)->text;
+        case AST_INT_LITERAL:     return cast<IntLiteralAST>(expression)->text;
+        case AST_FLOAT_LITERAL:   return cast<FloatLiteralAST>(expression)->text;
+        case AST_STRING_LITERAL:  return cast<StringLiteralAST>(expression)->text;
+        case AST_FUNCTION_CALL:   return cast<FunctionCallAST>(expression)->name;
+        case AST_BINARY_OPERATION: return cast<BinaryOperationAST>(expression)->token;
+        case AST_NOT_OPERATION:
+            expression = cast<NotOperationAST>(expression)->expression;
+            break;
+        case AST_NEGATION:
+            expression = cast<NegationAST>(expression)->expression;
+            break;
+        default:
+            assert(false);
+            return Token();
+        }
+    }
+}
+
+/* Prints the message and where it happened. Names imported from a module
+    interface have no text in this program, so they get no location. */
+static void report(
+    const Program & program, const Interner & interner, std::ostream & diagnostics,
+    const Token & token, const std::string & message
+) {
+    diagnostics << "ERR: " << message << std::endl;
+    if (token.symbol != Interner::NO_SYMBOL && program.extract(token) != interner.name(token.symbol)) {
+        return;
+    }
+    auto location = program.locate(token);
+    diagnostics << "ERR: line " << location.line << ", column " << location.column << std::endl;
+}
+
+// --------------------- FUNCTION BODIES --------------------- 
+/* Checks one function body at a time. Each thread has its own checker,
+    which only reads the Analyzer and writes to the nodes of the bodies it
+    was given. Every body is a scope, names are bound to slots. */
+class Analyzer::FunctionChecker : public ASTVisitor<FunctionChecker, uint32_t> {
+public:
+    FunctionChecker(const Analyzer & analyzer, std::ostream & diagnostics)
+    : analyzer(analyzer), types(analyzer.types), diagnostics(diagnostics),
+      scopes(analyzer.interner.size()) {}
+
+    bool check(const FunctionDefinitionAST * definition) {
+        failed = false;
+        prototype = definition->prototype;
+        slotTypes.clear();
+
+        scopes.enter();
+        for (auto & parameter : prototype->parameters) {
+            uint32_t slot = static_cast<uint32_t>(slotTypes.size());
+            slotTypes.push_back(parameter.type->resolved);
+            if (parameter.name.type != TOK_NULL) {
+                scopes.declare(parameter.name.symbol, slot);
+            }
+        }
+        check(definition->body);
+        scopes.leave();
+
+        definition->slotCount = static_cast<uint32_t>(slotTypes.size());
+        return !failed;
+    }
+
+    // ---- statements ----
+    uint32_t visitVariableDefinition(const VariableDefinitionAST * definition) {
+        // the initializer cannot see the name it initializes
+        uint32_t type = check(definition->expression);
+        uint32_t declared = definition->type->resolved;
+        if (type != NO_TYPE && declared != NO_TYPE && type != declared) {
+            error(tokenOf(definition->expression), "cannot initialize \"" + name(definition->name) +
+                "\" of type " + typeName(declared) + " with a value of type " + typeName(type));
+        }
+
+        uint32_t slot = static_cast<uint32_t>(slotTypes.size());
+        slotTypes.push_back(declared);
+        scopes.declare(definition->name.symbol, slot);
+        definition->slot = slot;
+        return NO_TYPE;
+    }
+
+    uint32_t visitWhileLoop(const WhileLoopAST * whileLoop) {
+        uint32_t type = check(whileLoop->condition);
+        if (type != NO_TYPE && type != BOOL_TYPE) {
+            error(tokenOf(whileLoop->condition), "while condition must be a bool, but got " + typeName(type));
+        }
+        check(whileLoop->body);
+        return NO_TYPE;
+    }
+
+    uint32_t visitReturn(const ReturnAST * returnStatement) {
+        uint32_t type = check(returnStatement->expression);
+        uint32_t expected = prototype->returnType->resolved;
+        if (type != NO_TYPE && expected != NO_TYPE && type != expected) {
+            error(tokenOf(returnStatement->expression), "\"" + name(prototype->name) + "\" returns " +
+                typeName(expected) + ", but got " + typeName(type));
+        }
+        return NO_TYPE;
+    }
+
+    // ---- expressions ----
+    uint32_t visitVariable(const VariableAST * variable) {
+        auto symbol = variable->text.symbol;
+        uint32_t slot = scopes.lookup(symbol);
+        if (slot != ScopedSymbolTable::UNBOUND) {
+            variable->slot = slot;
+            return slotTypes[slot];
+        }
+
+        if (analyzer.kernels[symbol]) {
+            variable->slot = VariableAST::GLOBAL;
+            return analyzer.kernelType;
+        }
+
+        error(variable->text, "undefined variable \"" + name(variable->text) + "\"");
+        return NO_TYPE;
+    }
+
+    uint32_t visitIntLiteral(const IntLiteralAST *) {
+        return INT_TYPE;
+    }
+
+    uint32_t visitFloatLiteral(const FloatLiteralAST * literal) {
+        error(literal->text, "float literals are only supported in kernels");
+        return NO_TYPE;
+    }
+
+    uint32_t visitStringLiteral(const StringLiteralAST *) {
+        return analyzer.stringType;
+    }
+
+    uint32_t visitFunctionCall(const FunctionCallAST * call) {
+        auto callee = analyzer.functions[call->name.symbol];
+        if (callee == nullptr) {
+            error(call->name, "attempting to call undefined method \"" + name(call->name) + "\"");
+            return NO_TYPE;
+        }
+
+        size_t paramCount = callee->parameters.size();
+        size_t passedArgCount = call->arguments.size();
+        if (paramCount != passedArgCount) {
+            error(call->name, "expected " + std::to_string(paramCount) + " arguments passed to \"" +
+                name(call->name) + "\", but got " + std::to_string(passedArgCount));
+        }
+
+        for (size_t i = 0; i < passedArgCount; i++) {
+            auto argument = call->arguments[i];
+            uint32_t type = check(argument);
+            if (i >= paramCount) continue;
+
+            uint32_t expected = callee->parameters[i].type->resolved;
+            if (type != NO_TYPE && expected != NO_TYPE && type != expected) {
+                error(tokenOf(argument), "argument " + std::to_string(i + 1) + " of \"" + name(call->name) +
+                    "\" should be " + typeName(expected) + ", but got " + typeName(type));
+            }
+        }
+
+        return callee->returnType->resolved;
+    }
+
+    uint32_t visitNotOperation(const NotOperationAST * operation) {
+        return checkPrefixRun(operation);
+    }
+
+    uint32_t visitNegation(const NegationAST * negation) {
+        return checkPrefixRun(negation);
+    }
+
+    // a run like !-!x is walked with a loop as well, innermost operator first
+    uint32_t checkPrefixRun(const ExpressionAST * outermost) {
+        std::vector<const ExpressionAST *> run;
+        const ExpressionAST * innermost = outermost;
+        while (auto operand = prefixOperand(innermost)) {
+            run.push_back(innermost);
+            innermost = operand;
+        }
+
+        uint32_t type = check(innermost);
+        for (auto link = run.rbegin(); link != run.rend(); ++link) {
+            type = checkPrefix(*link, type);
+            (*link)->type = type;
+        }
+        return type;
+    }
+
+    uint32_t checkPrefix(const ExpressionAST * operation, uint32_t type) {
+        if (type == NO_TYPE) return NO_TYPE;
+
+        if (isa<NotOperationAST>(operation)) {
+            if (type != BOOL_TYPE && !isInteger(type)) {
+                error(tokenOf(operation), "operator \"!\" expects a bool or an int, but got " + typeName(type));
+                return NO_TYPE;
+            }
+        } else if (!isInteger(type)) {
+            error(tokenOf(operation), "cannot negate a value of type " + typeName(type));
+            return NO_TYPE;
+        }
+        return type;
+    }
+
+    // a left spine as long as the chain, walked with a loop like in the code generators
+    uint32_t visitBinaryOperation(const BinaryOperationAST * operation) {
+        std::vector<const BinaryOperationAST *> chain;
+        const ExpressionAST * innermost = operation;
+        while (auto binary = dyn_cast<BinaryOperationAST>(innermost)) {
+            chain.push_back(binary);
+            innermost = binary->left;
+        }
+
+        uint32_t type = check(innermost);
+        for (auto link = chain.rbegin(); link != chain.rend(); ++link) {
+            uint32_t right = check((*link)->right);
+            type = check(*link, type, right);
+            (*link)->type = type;
+        }
+        return type;
+    }
+
+    // only bodies reach the checker, never top level declarations
+    uint32_t visitAST(const AST *) {
+        assert(false);
+        return NO_TYPE;
+    }
+
+private:
+    const Analyzer & analyzer;
+    const TypeTable & types;
+    std::ostream & diagnostics;
+
+    const FunctionPrototypeAST * prototype = nullptr;
+    bool failed = false;
+
+    std::vector<uint32_t> slotTypes; // indexed by slot
+    ScopedSymbolTable scopes;        // symbol to slot
+
+    void check(const BodyAST * body) {
+        scopes.enter();
+        for (auto statement : body->statements) {
+            if (auto expression = dyn_cast<ExpressionAST>(statement)) {
+                check(expression);
+            } else {
+                visit(statement);
+            }
+        }
+        scopes.leave();
+    }
+
+    uint32_t check(const ExpressionAST * expression) {
+        uint32_t type = visit(expression);
+        expression->type = type;
+        return type;
+    }
+
+    uint32_t check(const BinaryOperationAST * operation, uint32_t left, uint32_t right) {
+        if (left == NO_TYPE || right == NO_TYPE) return NO_TYPE;
+
+        auto symbol = std::string(analyzer.program.extract(operation->token));
+        if (left != right) {
+            error(operation->token, "operands of \"" + symbol + "\" have different types, " +
+                typeName(left) + " and " + typeName(right));
+            return NO_TYPE;
+        }
+
+        // bools also take the bitwise operators, pointers may only be compared for equality
+        bool isEquality = operation->op == BINARY_EQUAL || operation->op == BINARY_NOT_EQUAL;
+        bool isBitwise = operation->op == BINARY_AND || operation->op == BINARY_OR || operation->op == BINARY_XOR;
+        bool isAllowed = isInteger(left) ||
+            (left == BOOL_TYPE && (isEquality || isBitwise)) ||
+            (types.id(left) == TYPE_POINTER && isEquality);
+        if (!isAllowed) {
+            error(operation->token, "operator \"" + symbol + "\" expects int operands, but got " + typeName(left));
+            return NO_TYPE;
+        }
+
+        return operation->isComparison() ? BOOL_TYPE : left;
+    }
+
+    void error(const Token & token, const std::string & message) {
+        failed = true;
+        report(analyzer.program, analyzer.interner, diagnostics, token, message);
+    }
+
+    std::string name(const Token & token) const {
+        return std::string(analyzer.interner.name(token.symbol));
+    }
+
+    std::string typeName(uint32_t type) const {
+        return types.name(type, analyzer.interner);
+    }
+};
+
+
+// --------------------- KERNELS --------------------- 
+enum KernelType {
+    KERNEL_NONE, // after an error
+    KERNEL_FLOAT,
+    KERNEL_VEC4
+};
+
+/* Kernels are lowered to SPIR-V, which only has floats and vec4s so far.
+    Whatever else a kernel's return statements use is reported here, so the
+    SPIRVGenerator never sees it. */
+class Analyzer::KernelChecker : public ASTVisitor<KernelChecker, KernelType> {
+public:
+    KernelChecker(const Analyzer & analyzer, std::ostream & diagnostics)
+    : analyzer(analyzer), diagnostics(diagnostics) {}
+
+    bool check(const FunctionDefinitionAST * definition) {
+        failed = false;
+        for (auto statement : definition->body->statements) {
+            auto returnStatement = dyn_cast<ReturnAST>(statement);
+            if (returnStatement == nullptr) continue;
+
+            auto expression = returnStatement->expression;
+            KernelType type = visit(expression);
+            if (type == KERNEL_FLOAT) {
+                error(tokenOf(expression), "kernels return a vec4, but got a float");
+            }
+        }
+        return !failed;
+    }
+
+    KernelType visitFloatLiteral(const FloatLiteralAST *) {
+        return KERNEL_FLOAT;
+    }
+
+    KernelType visitFunctionCall(const FunctionCallAST * call) {
+        if (analyzer.interner.name(call->name.symbol) != "vec4") {
+            error(call->name, "only vec4 can be called in kernels");
+            return KERNEL_NONE;
+        }
+
+        KernelType type = KERNEL_VEC4;
+        for (auto argument : call->arguments) {
+            KernelType argumentType = visit(argument);
+            if (argumentType == KERNEL_VEC4) {
+                error(tokenOf(argument), "vec4 takes floats, but got a vec4");
+            }
+            if (argumentType != KERNEL_FLOAT) type = KERNEL_NONE;
+        }
+        return type;
+    }
+
+    KernelType visitNotOperation(const NotOperationAST * operation) {
+        return checkPrefixRun(operation);
+    }
+
+    KernelType visitNegation(const NegationAST * negation) {
+        return checkPrefixRun(negation);
+    }
+
+    KernelType checkPrefixRun(const ExpressionAST * expression) {
+        while (auto operand = prefixOperand(expression)) {
+            if (isa<NotOperationAST>(expression)) {
+                error(tokenOf(expression), "operator \"!\" is not supported in kernels");
+                return KERNEL_NONE;
+            }
+            expression = operand;
+        }
+        return visit(expression);
+    }
+
+    KernelType visitBinaryOperation(const BinaryOperationAST * operation) {
+        std::vector<const BinaryOperationAST *> chain;
+        const ExpressionAST * innermost = operation;
+        while (auto binary = dyn_cast<BinaryOperationAST>(innermost)) {
+            chain.push_back(binary);
+            innermost = binary->left;
+        }
+
+        KernelType type = visit(innermost);
+        for (auto link = chain.rbegin(); link != chain.rend(); ++link) {
+            KernelType right = visit((*link)->right);
+            type = check(*link, type, right);
+        }
+        return type;
+    }
+
+    // vec4 * float scales every component, other operators take two of a kind
+    KernelType check(const BinaryOperationAST * operation, KernelType left, KernelType right) {
+        auto symbol = std::string(analyzer.program.extract(operation->token));
+        if (operation->op > BINARY_REMAINDER) {
+            error(operation->token, "operator \"" + symbol + "\" is not supported in kernels");
+            return KERNEL_NONE;
+        }
+        if (left == KERNEL_NONE || right == KERNEL_NONE) return KERNEL_NONE;
+
+        if (left != right) {
+            if (operation->op == BINARY_MULTIPLY) return KERNEL_VEC4;
+            error(operation->token, "operands of \"" + symbol + "\" have different types, " +
+                typeName(left) + " and " + typeName(right));
+            return KERNEL_NONE;
+        }
+        return left;
+    }
+
+    KernelType visitExpression(const ExpressionAST * expression) {
+        error(tokenOf(expression), "kernels only support float literals, vec4 and arithmetic on them");
+        return KERNEL_NONE;
+    }
+
+private:
+    const Analyzer & analyzer;
+    std::ostream & diagnostics;
+    bool failed;
+
+    void error(const Token & token, const std::string & message) {
+        failed = true;
+        report(analyzer.program, analyzer.interner, diagnostics, token, message);
+    }
+
+    static std::string typeName(KernelType type) {
+        return type == KERNEL_VEC4 ? "vec4" : "float";
+    }
+};
+
+
+// --------------------- ANALYZER --------------------- 
+Analyzer::Analyzer(const Program & program, Interner & interner, TypeTable & types)
+: program(program), interner(interner), types(types) {
+    // kernels are values of the runtime's Kernel struct, see IRGenerator
+    kernelSymbol = interner.intern("Kernel");
+    kernelType = types.pointer(types.structure(kernelSymbol));
+    stringType = types.pointer(TypeTable::primitive(PRIMITIVE_BYTE));
+}
+
+Error Analyzer::analyze(const std::vector<const AST *> & ast, unsigned jobs) {
+    size_t symbolCount = interner.size();
+    functions.assign(symbolCount, nullptr);
+    kernels.assign(symbolCount, false);
+    incompleteStructs.assign(symbolCount, false);
+    definitions.clear();
+
+    bool success = true;
+    std::vector<bool> defined(symbolCount, false);
+    std::vector<std::pair<const FunctionPrototypeAST *, const FunctionPrototypeAST *>> redeclarations;
+
+    // every name at the top level is visible everywhere, collect them first
+    for (auto node : ast) {
+        const FunctionPrototypeAST * prototype = nullptr;
+        switch (node->getKind()) {
+        case AST_FUNCTION_DECLARATION:
+        {
+            auto declaration = cast<FunctionDeclarationAST>(node);
+            if (declaration->isKernel) {
+                kernels[declaration->prototype->name.symbol] = true;
+            } else {
+                prototype = declaration->prototype;
+            }
+            break;
+        }
+        case AST_FUNCTION_DEFINITION:
+        {
+            auto definition = cast<FunctionDefinitionAST>(node);
+            auto symbol = definition->prototype->name.symbol;
+            if (definition->isKernel) {
+                kernels[symbol] = true;
+                break;
+            }
+
+            if (defined[symbol]) {
+                report(program, interner, std::cerr, definition->prototype->name,
+                    "function \"" + std::string(interner.name(symbol)) + "\" is defined twice");
+                success = false;
+                break;
+            }
+            defined[symbol] = true;
+            prototype = definition->prototype;
+            definitions.push_back(definition);
+            break;
+        }
+        case AST_INCOMPLETE_STRUCT:
+            incompleteStructs[cast<IncompleteStructAST>(node)->name.symbol] = true;
+            break;
+        case AST_IMPORT:
+            // already replaced by the imported declarations, see ModuleInterface::resolve
+            break;
+        default:
+            assert(false);
+        }
+
+        if (prototype == nullptr) continue;
+
+        auto & function = functions[prototype->name.symbol];
+        if (function != nullptr) {
+            redeclarations.push_back({ function, prototype });
+        } else {
+            function = prototype;
+        }
+    }
+
+    /* Written types are resolved up front, so the type table does not change
+        while bodies are checked on several threads. */
+    KernelChecker kernelChecker(*this, std::cerr);
+    for (auto node : ast) {
+        if (auto declaration = dyn_cast<FunctionDeclarationAST>(node)) {
+            if (!declaration->isKernel) {
+                success = resolve(declaration->prototype) && success;
+            }
+        } else if (auto definition = dyn_cast<FunctionDefinitionAST>(node)) {
+            if (!definition->isKernel) {
+                success = resolve(definition->prototype) && success;
+                success = resolve(definition->body) && success;
+            } else {
+                success = kernelChecker.check(definition) && success;
+            }
+        }
+    }
+
+    // declarations and the definition must agree, calls are checked against either
+    for (auto & [first, second] : redeclarations) {
+        bool same = first->returnType->resolved == second->returnType->resolved &&
+            first->parameters.size() == second->parameters.size();
+        for (size_t i = 0; same && i < first->parameters.size(); i++) {
+            same = first->parameters[i].type->resolved == second->parameters[i].type->resolved;
+        }
+
+        if (!same) {
+            report(program, interner, std::cerr, second->name,
+                "conflicting declarations of \"" + std::string(interner.name(second->name.symbol)) + "\"");
+            success = false;
+        }
+    }
+
+    size_t chunkCount = std::min<size_t>(jobs, definitions.size() / MIN_CHUNK_FUNCTIONS);
+    if (chunkCount <= 1) {
+        FunctionChecker checker(*this, std::cerr);
+        for (auto definition : definitions) {
+            success = checker.check(definition) && success;
+        }
+        return success ? ERR_NONE : ERR_SEMANTIC_ANALYSIS;
+    }
+
+    std::vector<std::stringstream> messages(chunkCount);
+    std::vector<char> results(chunkCount, false);
+
+    auto checkChunk = [&](size_t i) {
+        size_t begin = definitions.size() * i / chunkCount;
+        size_t end = definitions.size() * (i + 1) / chunkCount;
+
+        FunctionChecker checker(*this, messages[i]);
+        bool chunkSuccess = true;
+        for (size_t j = begin; j < end; j++) {
+            chunkSuccess = checker.check(definitions[j]) && chunkSuccess;
+        }
+        results[i] = chunkSuccess;
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < chunkCount; i++) {
+        threads.emplace_back(checkChunk, i);
+    }
+    checkChunk(0);
+    for (auto & thread : threads) thread.join();
+
+    // messages come out in the same order as when checked serially
+    for (size_t i = 0; i < chunkCount; i++) {
+        std::cerr << messages[i].str();
+        success = results[i] && success;
+    }
+
+    return success ? ERR_NONE : ERR_SEMANTIC_ANALYSIS;
+}
+
+// --------------------- TYPES --------------------- 
+bool Analyzer::resolve(const TypeAST * type) {
+    std::vector<const PointerTypeAST *> pointers;
+    const TypeAST * base = type;
+    while (auto pointer = dyn_cast<PointerTypeAST>(base)) {
+        pointers.push_back(pointer);
+        base = pointer->type;
+    }
+
+    uint32_t resolved;
+    if (auto primitive = dyn_cast<PrimitiveTypeAST>(base)) {
+        resolved = TypeTable::primitive(primitive->primitive);
+    } else {
+        auto structType = cast<StructTypeAST>(base);
+        auto symbol = structType->name.symbol;
+        auto name = std::string(interner.name(symbol));
+        if (symbol != kernelSymbol && !incompleteStructs[symbol]) {
+            report(program, interner, std::cerr, structType->name, "unknown type \"" + name + "\"");
+            return false;
+        }
+        if (incompleteStructs[symbol] && pointers.empty()) {
+            report(program, interner, std::cerr, structType->name, 
+                "incomplete struct \"" + name + "\" can only be used behind a pointer");
+            return false;
+        }
+        resolved = types.structure(symbol);
+    }
+
+    base->resolved = resolved;
+    for (auto pointer = pointers.rbegin(); pointer != pointers.rend(); ++pointer) {
+        resolved = types.pointer(resolved);
+        (*pointer)->resolved = resolved;
+    }
+    return true;
+}
+
+bool Analyzer::resolve(const FunctionPrototypeAST * prototype) {
+    bool success = resolve(prototype->returnType);
+    for (auto & parameter : prototype->parameters) {
+        success = resolve(parameter.type) && success;
+    }
+    return success;
+}
+
+// only the types of lets, expressions get theirs when the body is checked
+bool Analyzer::resolve(const BodyAST * body) {
+    bool success = true;
+    for (auto statement : body->statements) {
+        if (auto definition = dyn_cast<VariableDefinitionAST>(statement)) {
+            success = resolve(definition->type) && success;
+        } else if (auto whileLoop = dyn_cast<WhileLoopAST>(statement)) {
+            success = resolve(whileLoop->body) && success;
+        }
+    }
+    return success;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "../include/Arena.h"
+#include <algorithm>
+
+Arena::Arena() : current(nullptr), limit(nullptr) {
+    nextBlockSize = MIN_BLOCK_SIZE;
+    reserved = 0;
+}
+
+size_t Arena::capacity() const {
+    return reserved;
+}
+
+void Arena::adopt(Arena & other) {
+    for (auto & block : other.blocks) {
+        blocks.push_back(std::move(block));
+    }
+    reserved += other.reserved;
+
+    other.blocks.clear();
+    other.current = nullptr;
+    other.limit = nullptr;
+    other.nextBlockSize = MIN_BLOCK_SIZE;
+    other.reserved = 0;
+}
+
+/* Starts a new block big enough for size bytes. Blocks double in size up to
+    a limit, so small trees stay small and large ones make few allocations. */
+void * Arena::allocateBlock(size_t size) {
+    size_t blockSize = std::max(nextBlockSize, size);
+    nextBlockSize = std::min(nextBlockSize * 2, MAX_BLOCK_SIZE);
+
+    size_t count = (blockSize + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+    blocks.emplace_back(new std::max_align_t[count]);
+    reserved += count * sizeof(std::max_align_t);
+
+    auto block = reinterpret_cast<char *>(blocks.back().get());
+    current = block + size;
+    limit = block + count * sizeof(std::max_align_t);
+    return block;
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "../include/ConstantFolder.h"
+#include <cmath>
+#include <cstdint>
+
+ConstantFolder::ConstantFolder(Arena & arena) : arena(arena) {}
+
+ExpressionAST * ConstantFolder::foldBinary(
+    BinaryOperator op, Token token, const ExpressionAST * left, const ExpressionAST * right
+) {
+    auto leftInt = dyn_cast<IntLiteralAST>(left);
+    auto rightInt = dyn_cast<IntLiteralAST>(right);
+    if (leftInt != nullptr && rightInt != nullptr) {
+        return foldInt(op, token, leftInt->value, rightInt->value);
+    }
+
+    auto leftFloat = dyn_cast<FloatLiteralAST>(left);
+    auto rightFloat = dyn_cast<FloatLiteralAST>(right);
+    if (leftFloat != nullptr && rightFloat != nullptr) {
+        return foldFloat(op, token, leftFloat->value, rightFloat->value);
+    }
+
+    return nullptr;
+}
+
+ExpressionAST * ConstantFolder::foldNegation(Token token, const ExpressionAST * operand) {
+    if (auto literal = dyn_cast<IntLiteralAST>(operand)) {
+        return arena.make<IntLiteralAST>(token, 0u - literal->value);
+    }
+    if (auto literal = dyn_cast<FloatLiteralAST>(operand)) {
+        return arena.make<FloatLiteralAST>(token, -literal->value);
+    }
+    return nullptr;
+}
+
+ExpressionAST * ConstantFolder::foldNot(Token token, const ExpressionAST * operand) {
+    // "!" on an int flips every bit, as in the IR
+    if (auto literal = dyn_cast<IntLiteralAST>(operand)) {
+        return arena.make<IntLiteralAST>(token, ~literal->value);
+    }
+    return nullptr;
+}
+
+/* Ints are 32-bit two's complement. Arithmetic is done unsigned, where
+    wrapping around is defined, and division and shifts right are signed. */
+ExpressionAST * ConstantFolder::foldInt(BinaryOperator op, Token token, uint32_t left, uint32_t right) {
+    auto signedLeft = static_cast<int32_t>(left);
+    auto signedRight = static_cast<int32_t>(right);
+    bool overflows = signedLeft == INT32_MIN && signedRight == -1;
+
+    uint32_t value;
+    switch (op) {
+    case BINARY_ADD:
+        value = left + right;
+        break;
+    case BINARY_SUBTRACT:
+        value = left - right;
+        break;
+    case BINARY_MULTIPLY:
+        value = left * right;
+        break;
+    case BINARY_DIVIDE:
+        if (right == 0 || overflows) return nullptr;
+        value = static_cast<uint32_t>(signedLeft / signedRight);
+        break;
+    case BINARY_REMAINDER:
+        if (right == 0 || overflows) return nullptr;
+        value = static_cast<uint32_t>(signedLeft % signedRight);
+        break;
+    case BINARY_AND:
+        value = left & right;
+        break;
+    case BINARY_OR:
+        value = left | right;
+        break;
+    case BINARY_XOR:
+        value = left ^ right;
+        break;
+    case BINARY_SHIFT_LEFT:
+        if (right >= 32) return nullptr;
+        value = left << right;
+        break;
+    case BINARY_SHIFT_RIGHT:
+        if (right >= 32) return nullptr;
+        // sign-filling, unlike >> on a negative int before C++20
+        value = signedLeft < 0 ? ~(~left >> right) : left >> right;
+        break;
+    default:
+        // comparisons yield a bool, which has no literal
+        return nullptr;
+    }
+
+    return arena.make<IntLiteralAST>(token, value);
+}
+
+ExpressionAST * ConstantFolder::foldFloat(BinaryOperator op, Token token, float left, float right) {
+    float value;
+    switch (op) {
+    case BINARY_ADD:
+        value = left + right;
+        break;
+    case BINARY_SUBTRACT:
+        value = left - right;
+        break;
+    case BINARY_MULTIPLY:
+        value = left * right;
+        break;
+    case BINARY_DIVIDE:
+        value = left / right;
+        break;
+    case BINARY_REMAINDER:
+        value = std::fmod(left, right);
+        break;
+    default:
+        return nullptr;
+    }
+
+    return arena.make<FloatLiteralAST>(token, value);
+}
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "../include/Document.h"
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include "../include/Parser.h"
+
+/* An attribute starts the declaration it is written on, so the fun or ker
+    after "@name" continues it rather than starting another. */
+static bool isDeclarationStart(const TokenBuffer & tokens, size_t index) {
+    auto type = tokens.type(index);
+    if (type == TOK_FUN || type == TOK_KER) {
+        return index < 2 || tokens.type(index - 2) != TOK_AT || tokens.type(index - 1) != TOK_IDENTIFIER;
+    }
+    return type == TOK_AT || type == TOK_STRUCT || type == TOK_IMPORT;
+}
+
+Document::Document() : program(std::make_unique<Program>(text)) {
+    lexerErrorOffset = 0;
+}
+
+void Document::open(std::string text) {
+    this->text = std::move(text);
+    program = std::make_unique<Program>(this->text);
+
+    relexAll();
+    declarations.clear();
+    if (lexerError.empty()) {
+        reparse(0, 0, 0, tokens.size());
+    }
+}
+
+EditStatistics Document::edit(size_t start, size_t end, std::string_view replacement) {
+    assert(start <= end && end <= text.size());
+
+    int64_t delta = static_cast<int64_t>(replacement.size()) - static_cast<int64_t>(end - start);
+    text.replace(start, end - start, replacement);
+    program = std::make_unique<Program>(text);
+
+    // the previous text never lexed, so there is nothing to reuse
+    if (!lexerError.empty()) {
+        open(std::move(text));
+        return { tokens.size(), declarations.size() };
+    }
+
+    size_t first, oldLast;
+    size_t relexed = relex(start, end, delta, &first, &oldLast);
+    if (!lexerError.empty()) {
+        declarations.clear();
+        return { relexed, 0 };
+    }
+
+    int64_t tokenDelta = static_cast<int64_t>(relexed) - static_cast<int64_t>(oldLast - first);
+
+    // the declaration before the damage is included in case its successor's
+    // keyword was edited away
+    auto firstDeclaration = std::lower_bound(
+        declarations.begin(), declarations.end(), first,
+        [](const Declaration & declaration, size_t token) { return declaration.firstToken < token; }
+    );
+    if (firstDeclaration != declarations.begin()) firstDeclaration--;
+
+    auto lastDeclaration = std::lower_bound(
+        firstDeclaration, declarations.end(), oldLast,
+        [](const Declaration & declaration, size_t token) { return declaration.firstToken < token; }
+    );
+
+    // a leading piece without a keyword absorbs tokens inserted before it
+    if (lastDeclaration != declarations.end() && 
+        !isDeclarationStart(tokens, lastDeclaration->firstToken + tokenDelta)) {
+        lastDeclaration++;
+    }
+
+    size_t from = firstDeclaration != declarations.end() ? firstDeclaration->firstToken : 0;
+
+    for (auto it = lastDeclaration; it != declarations.end(); it++) {
+        it->firstToken += tokenDelta;
+        it->shift += delta;
+    }
+
+    size_t to = lastDeclaration != declarations.end() ? lastDeclaration->firstToken : tokens.size();
+    size_t reparsed = reparse(
+        firstDeclaration - declarations.begin(), lastDeclaration - declarations.begin(), from, to
+    );
+
+    return { relexed, reparsed };
+}
+
+const Program & Document::getProgram() const {
+    return *program;
+}
+
+const TokenBuffer & Document::getTokens() const {
+    return tokens;
+}
+
+const Interner & Document::getInterner() const {
+    return interner;
+}
+
+const std::vector<Declaration> & Document::getDeclarations() const {
+    return declarations;
+}
+
+const std::string & Document::getLexerError() const {
+    return lexerError;
+}
+
+size_t Document::getLexerErrorOffset() const {
+    return lexerErrorOffset;
+}
+
+void Document::relexAll() {
+    tokens = TokenBuffer();
+    lexerError.clear();
+
+    // errors are reported to the editor, not printed
+    std::stringstream diagnostics;
+    Lexer lexer(*program, interner, diagnostics);
+    if (lexer.tokenize(tokens) != ERR_NONE) {
+        lexerError = "invalid token";
+        lexerErrorOffset = lexer.getErrorOffset();
+    }
+}
+
+/* Re-lexes from the last token boundary before start until a new token lines
+    up with an old token past end. Old tokens [*first, *oldLast) are replaced,
+    returns how many tokens replaced them. */
+size_t Document::relex(size_t start, size_t end, int64_t delta, size_t * first, size_t * oldLast) {
+    size_t count = tokens.size();
+
+    // first token ending at or after the edit, it may grow into the new text
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        auto token = tokens[middle];
+        if (token.offset + token.length < start) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    *first = low;
+
+    // whitespace and comments before the edit may have changed too, so resume
+    // right after the previous token
+    size_t resume = 0;
+    if (*first > 0) {
+        auto previous = tokens[*first - 1];
+        resume = previous.offset + previous.length;
+    }
+
+    std::stringstream diagnostics;
+    Lexer lexer(*program, interner, diagnostics);
+    lexer.seek(resume);
+
+    TokenBuffer fresh;
+    size_t old = *first;
+    while (true) {
+        Token token;
+        if (lexer.next(&token) != ERR_NONE) {
+            lexerError = "invalid token";
+            lexerErrorOffset = lexer.getErrorOffset();
+            return fresh.size();
+        }
+
+        if (token.type == TOK_EOF) {
+            old = count;
+            break;
+        }
+
+        // old offsets past the edit have not been shifted yet
+        while (old < count && (tokens[old].offset < end || tokens[old].offset + delta < token.offset)) {
+            old++;
+        }
+
+        if (old < count) {
+            auto candidate = tokens[old];
+            if (candidate.offset + delta == token.offset &&
+                candidate.type == token.type && candidate.length == token.length) {
+                break;
+            }
+        }
+
+        fresh.push(token.type, token.offset, token.length, token.symbol);
+    }
+
+    tokens.replace(*first, old, fresh);
+    tokens.shift(*first + fresh.size(), delta);
+    *oldLast = old;
+    return fresh.size();
+}
+
+/* Splits tokens [firstToken, lastToken) at declaration keywords and parses each
+    piece, replacing declarations [firstDeclaration, lastDeclaration). */
+size_t Document::reparse(
+    size_t firstDeclaration, size_t lastDeclaration, size_t firstToken, size_t lastToken
+) {
+    std::vector<Declaration> fresh;
+    size_t start = firstToken;
+    for (size_t i = firstToken + 1; i <= lastToken; i++) {
+        if (i == lastToken || isDeclarationStart(tokens, i)) {
+            fresh.push_back(parseDeclaration(start, i));
+            start = i;
+        }
+    }
+
+    size_t count = fresh.size();
+    declarations.erase(declarations.begin() + firstDeclaration, declarations.begin() + lastDeclaration);
+    declarations.insert(
+        declarations.begin() + firstDeclaration,
+        std::make_move_iterator(fresh.begin()), std::make_move_iterator(fresh.end())
+    );
+    return count;
+}
+
+Declaration Document::parseDeclaration(size_t firstToken, size_t lastToken) const {
+    Declaration declaration;
+    declaration.firstToken = firstToken;
+    declaration.tokenCount = lastToken - firstToken;
+    declaration.shift = 0;
+    declaration.arena = std::make_unique<Arena>();
+    declaration.ast = nullptr;
+    declaration.errorOffset = 0;
+
+    std::stringstream diagnostics;
+    TokenStream stream(tokens, firstToken, lastToken);
+    Parser parser(*program, stream, *declaration.arena, diagnostics);
+
+    std::vector<const AST *> ast;
+    if (parser.parse(ast) == ERR_NONE && ast.size() == 1) {
+        declaration.ast = ast[0];
+    } else {
+        declaration.error = parser.getErrorMessage();
+        declaration.errorOffset = parser.getErrorOffset();
+    }
+
+    return declaration;
+}
\ No newline at end of file
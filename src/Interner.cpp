@@ -0,0 +1,69 @@
+#include "../include/Interner.h"
+#include <cassert>
+
+// FNV-1a, identifiers are short enough that anything fancier does not pay off
+uint32_t Interner::hash(std::string_view name) {
+    uint32_t value = 2166136261u;
+    for (char c : name) {
+        value = (value ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return value;
+}
+
+Interner::Interner() : slots(64, Slot { 0, NO_SYMBOL }) {
+    names.emplace_back();
+}
+
+uint32_t Interner::intern(std::string_view name) {
+    if (name.empty()) return NO_SYMBOL;
+
+    uint32_t nameHash = hash(name);
+    size_t mask = slots.size() - 1;
+    for (size_t i = nameHash & mask; ; i = (i + 1) & mask) {
+        Slot & slot = slots[i];
+        if (slot.symbol == NO_SYMBOL) {
+            assert(names.size() <= UINT32_MAX);
+            slot = { nameHash, static_cast<uint32_t>(names.size()) };
+            names.emplace_back(name);
+
+            // keep the load factor under one half
+            if (names.size() * 2 > slots.size()) grow();
+            return static_cast<uint32_t>(names.size() - 1);
+        }
+
+        if (slot.hash == nameHash && names[slot.symbol] == name) {
+            return slot.symbol;
+        }
+    }
+}
+
+std::string_view Interner::name(uint32_t symbol) const {
+    assert(symbol < names.size());
+    return names[symbol];
+}
+
+size_t Interner::size() const {
+    return names.size();
+}
+
+std::vector<uint32_t> Interner::merge(const Interner & other) {
+    std::vector<uint32_t> mapping(other.size());
+    for (size_t i = 0; i < other.size(); i++) {
+        mapping[i] = intern(other.names[i]);
+    }
+    return mapping;
+}
+
+void Interner::grow() {
+    std::vector<Slot> old(slots.size() * 2, Slot { 0, NO_SYMBOL });
+    old.swap(slots);
+
+    size_t mask = slots.size() - 1;
+    for (auto & slot : old) {
+        if (slot.symbol == NO_SYMBOL) continue;
+
+        size_t i = slot.hash & mask;
+        while (slots[i].symbol != NO_SYMBOL) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
\ No newline at end of file
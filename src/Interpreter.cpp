@@ -0,0 +1,534 @@
+#include "../include/Interpreter.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <llvm/Support/DynamicLibrary.h>
+#include "../include/IRGenerator.h"
+#include "../include/SPIRVGenerator.h"
+
+// runtime/cpu.cpp, compiled into the compiler for multiversioned programs
+extern "C" int calcium_cpu_level();
+
+// binary operators map onto bytecode in order
+static_assert(BC_GREATER_EQUAL - BC_ADD == BINARY_GREATER_EQUAL - BINARY_ADD);
+
+Interpreter::Interpreter(
+    Program & program,
+    const Interner & interner,
+    const TypeTable & types,
+    const OutputOptions & options,
+    const std::vector<std::string> & libraries,
+    bool tierUp
+) : program(program), interner(interner), types(types), libraries(libraries), tierUp(tierUp), jit(options, libraries) {}
+
+Interpreter::~Interpreter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (compiler.joinable()) {
+        compiler.join();
+    }
+}
+
+// imported declarations have no text in this program, only symbols
+std::string_view Interpreter::getName(const Token & token) const {
+    return token.symbol != Interner::NO_SYMBOL ? interner.name(token.symbol) : program.extract(token);
+}
+
+Interpreter::Width Interpreter::widthOf(uint32_t type) const {
+    if (types.id(type) != TYPE_PRIMITIVE) {
+        return WIDTH_POINTER;
+    }
+    switch (types.primitiveOf(type)) {
+    case PRIMITIVE_INT:  return WIDTH_INT;
+    case PRIMITIVE_BYTE: return WIDTH_BYTE;
+    default:             return WIDTH_BOOL;
+    }
+}
+
+
+// --------------------- SETUP ---------------------
+Error Interpreter::run(const std::vector<const AST *> & ast, int * exitCode) {
+    assert(exitCode != nullptr);
+    this->ast = &ast;
+
+    // runtime functions come from this process or the given libraries
+    std::string message;
+    if (llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr, &message)) {
+        std::cerr << "ERR: " << message << std::endl;
+        return ERR_RUN_PROGRAM;
+    }
+    for (auto & library : libraries) {
+        if (llvm::sys::DynamicLibrary::LoadLibraryPermanently(library.c_str(), &message)) {
+            std::cerr << "ERR: " << message << std::endl;
+            return ERR_RUN_PROGRAM;
+        }
+    }
+    llvm::sys::DynamicLibrary::AddSymbol("calcium_cpu_level", reinterpret_cast<void *>(&calcium_cpu_level));
+
+    functionsBySymbol.assign(interner.size(), UINT32_MAX);
+    globalsBySymbol.assign(interner.size(), UINT32_MAX);
+
+    // a declaration and the definition after it are the same function
+    for (auto node : ast) {
+        const FunctionPrototypeAST * prototype = nullptr;
+        const FunctionDefinitionAST * definition = nullptr;
+        if (auto declaration = dyn_cast<FunctionDeclarationAST>(node)) {
+            if (!declaration->isKernel) prototype = declaration->prototype;
+        } else if ((definition = dyn_cast<FunctionDefinitionAST>(node))) {
+            if (definition->isKernel) {
+                // small and few, so they are generated up front
+                SPIRVGenerator spirvGenerator(program);
+                auto & code = kernelCode.emplace_back(spirvGenerator.generate(definition));
+                kernels.push_back({ code.data(), code.size() });
+                globalsBySymbol[definition->prototype->name.symbol] = constants.size();
+                constants.push_back(reinterpret_cast<int64_t>(&kernels.back()));
+                continue;
+            }
+            prototype = definition->prototype;
+        }
+        if (prototype == nullptr) continue;
+
+        auto & index = functionsBySymbol[prototype->name.symbol];
+        if (index == UINT32_MAX) {
+            index = functions.size();
+            auto & function = functions.emplace_back();
+            function.prototype = prototype;
+            function.result = widthOf(prototype->returnType->resolved);
+        }
+        if (definition != nullptr) {
+            functions[index].definition = definition;
+        }
+    }
+
+    Function * main = nullptr;
+    for (auto & function : functions) {
+        if (function.definition == nullptr) continue;
+        auto err = compile(function);
+        if (err != ERR_NONE) return err;
+        if (getName(function.prototype->name) == "main") main = &function;
+    }
+
+    if (main == nullptr) {
+        std::cerr << "ERR: --run needs a program that defines main" << std::endl;
+        return ERR_RUN_PROGRAM;
+    }
+
+    stack.resize(1024);
+    int64_t result = execute(*main, 0);
+    if (failed) return ERR_RUN_PROGRAM;
+
+    // main returns an int or unit, the exit code is 0 for unit
+    *exitCode = main->result == WIDTH_INT ? int(result) : 0;
+    return ERR_NONE;
+}
+
+
+// --------------------- COMPILATION ---------------------
+/* Slots hold parameters and lets, as numbered by the Analyzer, and
+    temporaries are handed out above them. Every statement starts over at the
+    first temporary. */
+Error Interpreter::compile(Function & function) {
+    current = &function;
+    auto definition = function.definition;
+    temporaries = definition->slotCount;
+    function.registers = temporaries;
+
+    compile(definition->body);
+
+    // falling off the end returns zero, as in the generated IR
+    uint32_t zero = temporary();
+    emit(BC_INTEGER, zero, 0);
+    emit(BC_RETURN, zero);
+    return compileError;
+}
+
+void Interpreter::compile(const BodyAST * body) {
+    for (auto statement : body->statements) {
+        temporaries = current->definition->slotCount;
+
+        switch (statement->getKind()) {
+        case AST_VARIABLE_DEFINITION:
+        {
+            auto definition = cast<VariableDefinitionAST>(statement);
+            compile(definition->expression, definition->slot);
+            break;
+        }
+        case AST_WHILE_LOOP:
+        {
+            auto whileLoop = cast<WhileLoopAST>(statement);
+            size_t start = current->code.size();
+            uint32_t condition = operand(whileLoop->condition);
+            size_t exit = emit(BC_JUMP_IF_FALSE, condition);
+            compile(whileLoop->body);
+            emit(BC_LOOP, start);
+            current->code[exit].b = current->code.size();
+            break;
+        }
+        case AST_RETURN:
+            emit(BC_RETURN, operand(cast<ReturnAST>(statement)->expression));
+            break;
+        default:
+            compile(cast<ExpressionAST>(statement), temporary());
+        }
+    }
+}
+
+void Interpreter::compile(const ExpressionAST * expression, uint32_t destination) {
+    switch (expression->getKind()) {
+    case AST_INT_LITERAL:
+        emit(BC_INTEGER, destination, cast<IntLiteralAST>(expression)->value);
+        break;
+    case AST_STRING_LITERAL:
+    {
+        auto & text = strings.emplace_back(getName(cast<StringLiteralAST>(expression)->text));
+        emit(BC_CONSTANT, destination, constants.size());
+        constants.push_back(reinterpret_cast<int64_t>(text.c_str()));
+        break;
+    }
+    case AST_VARIABLE:
+    {
+        auto variable = cast<VariableAST>(expression);
+        if (variable->slot == VariableAST::GLOBAL) {
+            emit(BC_CONSTANT, destination, global(variable));
+        } else if (variable->slot != destination) {
+            emit(BC_MOVE, destination, variable->slot);
+        }
+        break;
+    }
+    case AST_NOT_OPERATION:
+    case AST_NEGATION:
+    {
+        // a prefix run is applied innermost first, in place in destination
+        std::vector<const ExpressionAST *> run;
+        const ExpressionAST * innermost = expression;
+        while (auto operand = prefixOperand(innermost)) {
+            run.push_back(innermost);
+            innermost = operand;
+        }
+
+        uint32_t source = operand(innermost);
+        for (auto link = run.rbegin(); link != run.rend(); ++link) {
+            if (isa<NotOperationAST>(*link)) {
+                bool isBool = widthOf((*link)->type) == WIDTH_BOOL;
+                emit(isBool ? BC_NOT_BOOL : BC_NOT, destination, source);
+            } else {
+                emit(BC_NEGATE, destination, source);
+                if (widthOf((*link)->type) == WIDTH_BYTE) {
+                    emit(BC_BYTE, destination, destination);
+                }
+            }
+            source = destination;
+        }
+        break;
+    }
+    case AST_BINARY_OPERATION:
+        compile(cast<BinaryOperationAST>(expression), destination);
+        break;
+    case AST_FUNCTION_CALL:
+    {
+        auto functionCall = cast<FunctionCallAST>(expression);
+        uint32_t index = functionsBySymbol[functionCall->name.symbol];
+        assert(index != UINT32_MAX);
+        auto & callee = functions[index];
+
+        if (callee.definition == nullptr && callee.native.load() == nullptr) {
+            auto name = std::string(getName(functionCall->name));
+            if (callee.prototype->parameters.size() > MAX_NATIVE_PARAMETERS) {
+                std::cerr << "ERR: \"" << name << "\" has more than " << MAX_NATIVE_PARAMETERS <<
+                    " parameters, --run can't call it" << std::endl;
+                compileError = ERR_RUN_PROGRAM;
+                return;
+            }
+            void * address = llvm::sys::DynamicLibrary::SearchForAddressOfSymbol(name);
+            if (address == nullptr) {
+                std::cerr << "ERR: symbol not found: \"" << name << "\"" << std::endl;
+                compileError = ERR_RUN_PROGRAM;
+                return;
+            }
+            callee.native.store(address);
+        }
+
+        // arguments go in consecutive registers
+        uint32_t first = temporaries;
+        for (size_t i = 0; i < functionCall->arguments.size(); i++) {
+            temporary();
+        }
+        for (size_t i = 0; i < functionCall->arguments.size(); i++) {
+            compile(functionCall->arguments[i], first + i);
+        }
+        emit(BC_CALL, destination, index, first);
+        break;
+    }
+    default:
+        // float literals only appear in kernels, see Analyzer
+        assert(false);
+    }
+}
+
+/* A chain like a + b + c nests to the left as deep as it is long, so the
+    left operands are walked with a loop rather than by recursion. */
+void Interpreter::compile(const BinaryOperationAST * operation, uint32_t destination) {
+    std::vector<const BinaryOperationAST *> chain;
+    const ExpressionAST * innermost = operation;
+    while (auto binary = dyn_cast<BinaryOperationAST>(innermost)) {
+        chain.push_back(binary);
+        innermost = binary->left;
+    }
+
+    uint32_t left = operand(innermost);
+    for (auto link = chain.rbegin(); link != chain.rend(); ++link) {
+        uint32_t right = operand((*link)->right);
+        uint32_t result = *link == operation ? destination : temporary();
+        emit(BytecodeOp(BC_ADD + (*link)->op), result, left, right);
+
+        // only these can leave a byte's range
+        bool wraps = (*link)->op <= BINARY_DIVIDE || (*link)->op == BINARY_SHIFT_LEFT;
+        if (wraps && widthOf((*link)->type) == WIDTH_BYTE) {
+            emit(BC_BYTE, result, result);
+        }
+        left = result;
+    }
+}
+
+// locals are read in place, anything else is computed into a temporary
+uint32_t Interpreter::operand(const ExpressionAST * expression) {
+    if (auto variable = dyn_cast<VariableAST>(expression)) {
+        if (variable->slot != VariableAST::GLOBAL) {
+            return variable->slot;
+        }
+    }
+    uint32_t destination = temporary();
+    compile(expression, destination);
+    return destination;
+}
+
+uint32_t Interpreter::temporary() {
+    uint32_t temporary = temporaries++;
+    current->registers = std::max(current->registers, temporaries);
+    return temporary;
+}
+
+// kernels defined here were made up front, imported ones come from the runtime
+uint32_t Interpreter::global(const VariableAST * variable) {
+    auto & index = globalsBySymbol[variable->text.symbol];
+    if (index == UINT32_MAX) {
+        auto name = std::string(getName(variable->text));
+        void * address = llvm::sys::DynamicLibrary::SearchForAddressOfSymbol(name);
+        if (address == nullptr) {
+            std::cerr << "ERR: symbol not found: \"" << name << "\"" << std::endl;
+            compileError = ERR_RUN_PROGRAM;
+            return 0;
+        }
+        index = constants.size();
+        constants.push_back(reinterpret_cast<int64_t>(address));
+    }
+    return index;
+}
+
+size_t Interpreter::emit(BytecodeOp op, uint32_t a, uint32_t b, uint32_t c) {
+    current->code.push_back({ op, a, b, c });
+    return current->code.size() - 1;
+}
+
+
+// --------------------- EXECUTION ---------------------
+#if defined(__GNUC__)
+// threaded dispatch, every handler jumps straight to the next one
+#define DISPATCH() goto *handlers[ip->op]
+#define HANDLER(op) L_##op:
+#else
+#define DISPATCH() continue
+#define HANDLER(op) case op:
+#endif
+
+#define NEXT() ip++; DISPATCH()
+
+// the arguments are on the stack at the given index, it may grow under them
+int64_t Interpreter::execute(Function & function, size_t arguments) {
+    if (depth == MAX_DEPTH) {
+        std::cerr << "ERR: calls nested more than " << MAX_DEPTH << " deep" << std::endl;
+        failed = true;
+        return 0;
+    }
+    depth++;
+
+    size_t base = top;
+    top += function.registers;
+    if (stack.size() < top) {
+        stack.resize(top * 2);
+    }
+
+    int64_t * r = stack.data() + base;
+    auto parameters = function.prototype->parameters.size();
+    std::copy(stack.data() + arguments, stack.data() + arguments + parameters, r);
+
+    const int64_t * constants = this->constants.data();
+    const Instruction * code = function.code.data();
+    const Instruction * ip = code;
+
+#if defined(__GNUC__)
+    // in BytecodeOp order
+    static const void * handlers[] = {
+        &&L_BC_INTEGER, &&L_BC_CONSTANT, &&L_BC_MOVE,
+        &&L_BC_ADD, &&L_BC_SUBTRACT, &&L_BC_MULTIPLY, &&L_BC_DIVIDE, &&L_BC_REMAINDER,
+        &&L_BC_AND, &&L_BC_OR, &&L_BC_XOR, &&L_BC_SHIFT_LEFT, &&L_BC_SHIFT_RIGHT,
+        &&L_BC_EQUAL, &&L_BC_NOT_EQUAL, &&L_BC_LESS, &&L_BC_LESS_EQUAL, &&L_BC_GREATER, &&L_BC_GREATER_EQUAL,
+        &&L_BC_NEGATE, &&L_BC_NOT, &&L_BC_NOT_BOOL, &&L_BC_BYTE,
+        &&L_BC_JUMP, &&L_BC_JUMP_IF_FALSE, &&L_BC_LOOP, &&L_BC_CALL, &&L_BC_RETURN
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == BC_RETURN + 1);
+    DISPATCH();
+#else
+    for (;;) switch (ip->op) {
+#endif
+
+    // ints wrap at 32 bits and are kept sign extended
+    HANDLER(BC_INTEGER)       r[ip->a] = int32_t(ip->b); NEXT();
+    HANDLER(BC_CONSTANT)      r[ip->a] = constants[ip->b]; NEXT();
+    HANDLER(BC_MOVE)          r[ip->a] = r[ip->b]; NEXT();
+    HANDLER(BC_ADD)           r[ip->a] = int32_t(uint32_t(r[ip->b]) + uint32_t(r[ip->c])); NEXT();
+    HANDLER(BC_SUBTRACT)      r[ip->a] = int32_t(uint32_t(r[ip->b]) - uint32_t(r[ip->c])); NEXT();
+    HANDLER(BC_MULTIPLY)      r[ip->a] = int32_t(uint32_t(r[ip->b]) * uint32_t(r[ip->c])); NEXT();
+    HANDLER(BC_DIVIDE)        r[ip->a] = int32_t(r[ip->b] / r[ip->c]); NEXT();
+    HANDLER(BC_REMAINDER)     r[ip->a] = r[ip->b] % r[ip->c]; NEXT();
+    HANDLER(BC_AND)           r[ip->a] = r[ip->b] & r[ip->c]; NEXT();
+    HANDLER(BC_OR)            r[ip->a] = r[ip->b] | r[ip->c]; NEXT();
+    HANDLER(BC_XOR)           r[ip->a] = r[ip->b] ^ r[ip->c]; NEXT();
+    HANDLER(BC_SHIFT_LEFT)    r[ip->a] = int32_t(uint32_t(r[ip->b]) << (r[ip->c] & 31)); NEXT();
+    HANDLER(BC_SHIFT_RIGHT)   r[ip->a] = r[ip->b] >> (r[ip->c] & 31); NEXT();
+    HANDLER(BC_EQUAL)         r[ip->a] = r[ip->b] == r[ip->c]; NEXT();
+    HANDLER(BC_NOT_EQUAL)     r[ip->a] = r[ip->b] != r[ip->c]; NEXT();
+    HANDLER(BC_LESS)          r[ip->a] = r[ip->b] < r[ip->c]; NEXT();
+    HANDLER(BC_LESS_EQUAL)    r[ip->a] = r[ip->b] <= r[ip->c]; NEXT();
+    HANDLER(BC_GREATER)       r[ip->a] = r[ip->b] > r[ip->c]; NEXT();
+    HANDLER(BC_GREATER_EQUAL) r[ip->a] = r[ip->b] >= r[ip->c]; NEXT();
+    HANDLER(BC_NEGATE)        r[ip->a] = int32_t(0u - uint32_t(r[ip->b])); NEXT();
+    HANDLER(BC_NOT)           r[ip->a] = ~r[ip->b]; NEXT();
+    HANDLER(BC_NOT_BOOL)      r[ip->a] = r[ip->b] ^ 1; NEXT();
+    HANDLER(BC_BYTE)          r[ip->a] = int8_t(r[ip->b]); NEXT();
+    HANDLER(BC_JUMP)          ip = code + ip->a; DISPATCH();
+    HANDLER(BC_JUMP_IF_FALSE)
+        ip = r[ip->a] ? ip + 1 : code + ip->b;
+        DISPATCH();
+    HANDLER(BC_LOOP)
+        if (++function.heat == HOT_THRESHOLD) promote(function);
+        ip = code + ip->a;
+        DISPATCH();
+    HANDLER(BC_CALL)
+    {
+        Function & callee = functions[ip->b];
+        int64_t result;
+        if (void * native = callee.native.load(std::memory_order_acquire)) {
+            result = callNative(callee, native, r + ip->c);
+        } else {
+            if (++callee.heat == HOT_THRESHOLD) promote(callee);
+            result = execute(callee, base + ip->c);
+            if (failed) {
+                top = base;
+                depth--;
+                return 0;
+            }
+            r = stack.data() + base;
+        }
+        r[ip->a] = result;
+        NEXT();
+    }
+    HANDLER(BC_RETURN)
+    {
+        int64_t result = r[ip->a];
+        top = base;
+        depth--;
+        return result;
+    }
+
+#if !defined(__GNUC__)
+    }
+#endif
+}
+
+#undef NEXT
+#undef HANDLER
+#undef DISPATCH
+
+/* Both the runtime and compiled Calcium only take ints, bytes, bools and
+    pointers, kept extended to 64 bits in registers. Natives are called
+    through a pointer with exactly their number of parameters, never a
+    variadic one, and on the targets in Interpreter::SUPPORTED each of the
+    first MAX_NATIVE_PARAMETERS such arguments takes one 64 bit register or
+    stack slot whatever its width. Results only fill the low bits of the
+    return register, so they are extended again. */
+int64_t Interpreter::callNative(const Function & function, void * native, const int64_t * a) {
+    typedef int64_t I;
+    int64_t result = 0;
+    switch (function.prototype->parameters.size()) {
+    case 0: result = reinterpret_cast<I (*)()>(native)(); break;
+    case 1: result = reinterpret_cast<I (*)(I)>(native)(a[0]); break;
+    case 2: result = reinterpret_cast<I (*)(I, I)>(native)(a[0], a[1]); break;
+    case 3: result = reinterpret_cast<I (*)(I, I, I)>(native)(a[0], a[1], a[2]); break;
+    case 4: result = reinterpret_cast<I (*)(I, I, I, I)>(native)(a[0], a[1], a[2], a[3]); break;
+    case 5: result = reinterpret_cast<I (*)(I, I, I, I, I)>(native)(a[0], a[1], a[2], a[3], a[4]); break;
+    case 6: result = reinterpret_cast<I (*)(I, I, I, I, I, I)>(native)(a[0], a[1], a[2], a[3], a[4], a[5]); break;
+    case 7: result = reinterpret_cast<I (*)(I, I, I, I, I, I, I)>(native)(a[0], a[1], a[2], a[3], a[4], a[5], a[6]); break;
+    case 8: result = reinterpret_cast<I (*)(I, I, I, I, I, I, I, I)>(native)(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]); break;
+    default: assert(false);
+    }
+
+    switch (function.result) {
+    case WIDTH_BOOL:    return result & 1;
+    case WIDTH_BYTE:    return int8_t(result);
+    case WIDTH_INT:     return int32_t(result);
+    case WIDTH_POINTER: return result;
+    }
+    return result;
+}
+
+
+// --------------------- PROMOTION ---------------------
+void Interpreter::promote(Function & function) {
+    if (!tierUp || function.promoted || function.prototype->parameters.size() > MAX_NATIVE_PARAMETERS) {
+        return;
+    }
+    function.promoted = true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(&function);
+    }
+    if (!compiler.joinable()) {
+        compiler = std::thread(&Interpreter::compileInBackground, this);
+    }
+    wake.notify_one();
+}
+
+/* The first promotion generates and adds the whole module, every one after
+    only looks its function up. If compiling fails the program just keeps
+    running in the interpreter. */
+void Interpreter::compileInBackground() {
+    bool added = false;
+    for (;;) {
+        Function * function;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) return;
+            function = queue.front();
+            queue.erase(queue.begin());
+        }
+
+        if (!added) {
+            auto llvmContext = std::make_unique<llvm::LLVMContext>();
+            auto llvmModule = std::make_unique<llvm::Module>("Calcium", *llvmContext);
+            IRGenerator irGenerator(program, interner, types, *llvmContext, *llvmModule);
+            irGenerator.generate(*ast);
+            if (jit.add(std::move(llvmContext), std::move(llvmModule)) != ERR_NONE) return;
+            added = true;
+        }
+
+        void * address;
+        if (jit.lookup(std::string(getName(function->prototype->name)), &address) != ERR_NONE) return;
+        function->native.store(address, std::memory_order_release);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "../include/JIT.h"
+#include "../include/LLVMVersion.h"
+#include <cassert>
+#include <iostream>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/PassTimingInfo.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+
+// runtime/cpu.cpp, compiled into the compiler for multiversioned programs
+extern "C" int calcium_cpu_level();
+
+static Error report(llvm::Error err) {
+    std::cerr << "ERR: " << llvm::toString(std::move(err)) << std::endl;
+    return ERR_RUN_PROGRAM;
+}
+
+JIT::JIT(const OutputOptions & options, const std::vector<std::string> & libraries)
+: options(options), libraries(libraries) {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+}
+
+Error JIT::add(std::unique_ptr<llvm::LLVMContext> llvmContext, std::unique_ptr<llvm::Module> llvmModule) {
+    assert(jit == nullptr);
+
+    auto machineBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!machineBuilder) return report(machineBuilder.takeError());
+    machineBuilder->setCodeGenOptLevel(options.optimization == OPTIMIZE_NONE ?
+        llvm::CodeGenOptLevel::None : llvm::CodeGenOptLevel::Default);
+
+    auto targetMachine = machineBuilder->createTargetMachine();
+    if (!targetMachine) return report(targetMachine.takeError());
+
+    llvmModule->setTargetTriple((*targetMachine)->getTargetTriple().str());
+    llvmModule->setDataLayout((*targetMachine)->createDataLayout());
+    Writer::optimize(*llvmModule, **targetMachine, options);
+
+    auto created = llvm::orc::LLJITBuilder()
+        .setJITTargetMachineBuilder(std::move(*machineBuilder))
+        .create();
+    if (!created) return report(created.takeError());
+    jit = std::move(*created);
+
+    auto & dylib = jit->getMainJITDylib();
+    char prefix = jit->getDataLayout().getGlobalPrefix();
+
+    auto process = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(prefix);
+    if (!process) return report(process.takeError());
+    dylib.addGenerator(std::move(*process));
+
+    for (auto & library : libraries) {
+        auto generator = llvm::orc::DynamicLibrarySearchGenerator::Load(library.c_str(), prefix);
+        if (!generator) return report(generator.takeError());
+        dylib.addGenerator(std::move(*generator));
+    }
+
+    // an executable doesn't export its own functions, define them by address
+    llvm::orc::SymbolMap runtime;
+    runtime[jit->mangleAndIntern("calcium_cpu_level")] = {
+#if LLVM_VERSION_MAJOR >= 17
+        llvm::orc::ExecutorAddr::fromPtr(&calcium_cpu_level), llvm::JITSymbolFlags::Exported
+#else
+        llvm::pointerToJITTargetAddress(&calcium_cpu_level), llvm::JITSymbolFlags::Exported
+#endif
+    };
+    if (auto err = dylib.define(llvm::orc::absoluteSymbols(std::move(runtime)))) return report(std::move(err));
+
+    auto module = llvm::orc::ThreadSafeModule(std::move(llvmModule), std::move(llvmContext));
+    if (auto err = jit->addIRModule(std::move(module))) return report(std::move(err));
+
+    // runs global constructors, e.g. the multiversioning dispatch
+    if (auto err = jit->initialize(dylib)) return report(std::move(err));
+    return ERR_NONE;
+}
+
+Error JIT::lookup(const std::string & name, void ** address) {
+    assert(jit != nullptr && address != nullptr);
+    auto found = jit->lookup(name);
+    if (!found) return report(found.takeError());
+#if LLVM_VERSION_MAJOR >= 15
+    *address = found->toPtr<void *>();
+#else
+    *address = llvm::jitTargetAddressToPointer<void *>(found->getAddress());
+#endif
+
+    // code generation is done by now
+    if (options.timePasses && !compiled) {
+        llvm::reportAndResetTimings(&llvm::errs());
+    }
+    compiled = true;
+    return ERR_NONE;
+}
+
+Error JIT::run(std::unique_ptr<llvm::LLVMContext> llvmContext, std::unique_ptr<llvm::Module> llvmModule, int * exitCode) {
+    assert(exitCode != nullptr);
+
+    // main returns an int or unit, the exit code is 0 for unit
+    auto entry = llvmModule->getFunction("main");
+    if (entry == nullptr || entry->isDeclaration()) {
+        std::cerr << "ERR: --run needs a program that defines main" << std::endl;
+        return ERR_RUN_PROGRAM;
+    }
+    bool returnsInt = entry->getReturnType()->isIntegerTy(32);
+
+    auto err = add(std::move(llvmContext), std::move(llvmModule));
+    if (err != ERR_NONE) return err;
+
+    void * address;
+    err = lookup("main", &address);
+    if (err != ERR_NONE) return err;
+
+    if (returnsInt) {
+        *exitCode = reinterpret_cast<int (*)()>(address)();
+    } else {
+        reinterpret_cast<bool (*)()>(address)();
+        *exitCode = 0;
+    }
+
+    if (auto err = jit->deinitialize(jit->getMainJITDylib())) return report(std::move(err));
+    return ERR_NONE;
+}
\ No newline at end of file
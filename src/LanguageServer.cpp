@@ -0,0 +1,253 @@
+#include "../include/LanguageServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <llvm/Support/raw_ostream.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+static const int METHOD_NOT_FOUND = -32601;
+static const int TEXT_DOCUMENT_SYNC_INCREMENTAL = 2;
+static const int SEVERITY_ERROR = 1;
+
+// LSP positions are zero-based, source locations are one-based
+static size_t toOffset(const Program & program, const llvm::json::Object * position) {
+    if (position == nullptr) return 0;
+
+    auto line = position->getInteger("line");
+    auto character = position->getInteger("character");
+    if (!line || !character) return 0;
+
+    return program.offset({ static_cast<size_t>(*line) + 1, static_cast<size_t>(*character) + 1 });
+}
+
+static llvm::json::Object toPosition(const Program & program, size_t offset) {
+    auto location = program.locate(offset);
+    return llvm::json::Object {
+        { "line", static_cast<int64_t>(location.line - 1) },
+        { "character", static_cast<int64_t>(location.column - 1) }
+    };
+}
+
+static llvm::json::Object toDiagnostic(const Program & program, size_t offset, const std::string & message) {
+    return llvm::json::Object {
+        { "range", llvm::json::Object {
+            { "start", toPosition(program, offset) },
+            { "end", toPosition(program, offset) }
+        }},
+        { "severity", SEVERITY_ERROR },
+        { "source", "calcium" },
+        { "message", message }
+    };
+}
+
+int LanguageServer::run() {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    std::string content;
+    while (read(&content)) {
+        auto message = llvm::json::parse(content);
+        if (!message) {
+            std::cerr << "ERR: malformed message: " << llvm::toString(message.takeError()) << std::endl;
+            continue;
+        }
+
+        auto object = message->getAsObject();
+        if (object == nullptr) continue;
+
+        auto method = object->getString("method");
+        if (!method) continue;
+
+        auto id = object->get("id");
+        auto params = object->getObject("params");
+
+        if (*method == "initialize" && id != nullptr) {
+            reply(*id, llvm::json::Object {
+                { "capabilities", llvm::json::Object {
+                    { "textDocumentSync", llvm::json::Object {
+                        { "openClose", true },
+                        { "change", TEXT_DOCUMENT_SYNC_INCREMENTAL }
+                    }}
+                }},
+                { "serverInfo", llvm::json::Object {{ "name", "calcium" }} }
+            });
+        } else if (*method == "shutdown" && id != nullptr) {
+            shuttingDown = true;
+            reply(*id, nullptr);
+        } else if (*method == "exit") {
+            return shuttingDown ? 0 : 1;
+        } else if (*method == "textDocument/didOpen" && params != nullptr) {
+            didOpen(*params);
+        } else if (*method == "textDocument/didChange" && params != nullptr) {
+            didChange(*params);
+        } else if (*method == "textDocument/didClose" && params != nullptr) {
+            didClose(*params);
+        } else if (id != nullptr) {
+            send(llvm::json::Object {
+                { "jsonrpc", "2.0" },
+                { "id", *id },
+                { "error", llvm::json::Object {
+                    { "code", METHOD_NOT_FOUND },
+                    { "message", "method not found: " + method->str() }
+                }}
+            });
+        }
+    }
+
+    return shuttingDown ? 0 : 1;
+}
+
+bool LanguageServer::read(std::string * content) {
+    const std::string prefix = "Content-Length: ";
+
+    size_t length = 0;
+    std::string header;
+    while (std::getline(std::cin, header)) {
+        if (!header.empty() && header.back() == '\r') header.pop_back();
+
+        if (!header.empty()) {
+            if (header.rfind(prefix, 0) == 0) {
+                length = std::strtoul(header.c_str() + prefix.size(), nullptr, 10);
+            }
+            continue;
+        }
+
+        if (length == 0) continue;
+
+        content->resize(length);
+        return static_cast<bool>(std::cin.read(&(*content)[0], length));
+    }
+
+    return false;
+}
+
+void LanguageServer::send(llvm::json::Value message) {
+    std::string body;
+    llvm::raw_string_ostream stream(body);
+    stream << message;
+    stream.flush();
+
+    std::cout << "Content-Length: " << body.size() << "\r\n\r\n" << body << std::flush;
+}
+
+void LanguageServer::reply(const llvm::json::Value & id, llvm::json::Value result) {
+    send(llvm::json::Object {
+        { "jsonrpc", "2.0" },
+        { "id", id },
+        { "result", std::move(result) }
+    });
+}
+
+void LanguageServer::notify(llvm::StringRef method, llvm::json::Value params) {
+    send(llvm::json::Object {
+        { "jsonrpc", "2.0" },
+        { "method", method },
+        { "params", std::move(params) }
+    });
+}
+
+void LanguageServer::didOpen(const llvm::json::Object & params) {
+    auto textDocument = params.getObject("textDocument");
+    if (textDocument == nullptr) return;
+
+    auto uri = textDocument->getString("uri");
+    auto text = textDocument->getString("text");
+    if (!uri || !text) return;
+
+    auto & document = documents[uri->str()];
+
+    auto start = std::chrono::steady_clock::now();
+    document.open(text->str());
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cerr << "INFO: opened " << uri->str() << " in " <<
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << "us" << std::endl;
+
+    publishDiagnostics(uri->str(), document);
+}
+
+void LanguageServer::didChange(const llvm::json::Object & params) {
+    auto textDocument = params.getObject("textDocument");
+    auto changes = params.getArray("contentChanges");
+    if (textDocument == nullptr || changes == nullptr) return;
+
+    auto uri = textDocument->getString("uri");
+    if (!uri) return;
+
+    auto it = documents.find(uri->str());
+    if (it == documents.end()) return;
+    auto & document = it->second;
+
+    for (auto & change : *changes) {
+        auto object = change.getAsObject();
+        if (object == nullptr) continue;
+
+        auto text = object->getString("text");
+        if (!text) continue;
+
+        auto start = std::chrono::steady_clock::now();
+
+        EditStatistics statistics;
+        if (auto range = object->getObject("range")) {
+            auto & program = document.getProgram();
+            size_t startOffset = toOffset(program, range->getObject("start"));
+            size_t endOffset = std::max(startOffset, toOffset(program, range->getObject("end")));
+            statistics = document.edit(startOffset, endOffset, *text);
+        } else {
+            document.open(text->str());
+            statistics = { document.getTokens().size(), document.getDeclarations().size() };
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        std::cerr << "INFO: edit took " <<
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << "us, re-lexed " <<
+            statistics.relexedTokens << " tokens, re-parsed " <<
+            statistics.reparsedDeclarations << " declarations" << std::endl;
+    }
+
+    publishDiagnostics(uri->str(), document);
+}
+
+void LanguageServer::didClose(const llvm::json::Object & params) {
+    auto textDocument = params.getObject("textDocument");
+    if (textDocument == nullptr) return;
+
+    auto uri = textDocument->getString("uri");
+    if (!uri) return;
+
+    documents.erase(uri->str());
+    notify("textDocument/publishDiagnostics", llvm::json::Object {
+        { "uri", *uri },
+        { "diagnostics", llvm::json::Array() }
+    });
+}
+
+void LanguageServer::publishDiagnostics(const std::string & uri, const Document & document) {
+    auto & program = document.getProgram();
+
+    llvm::json::Array diagnostics;
+    if (!document.getLexerError().empty()) {
+        diagnostics.push_back(toDiagnostic(program, document.getLexerErrorOffset(), document.getLexerError()));
+    }
+
+    for (auto & declaration : document.getDeclarations()) {
+        if (declaration.ast != nullptr) continue;
+
+        // the declaration was parsed before later edits moved it
+        size_t offset = static_cast<size_t>(static_cast<int64_t>(declaration.errorOffset) + declaration.shift);
+        diagnostics.push_back(toDiagnostic(program, offset, declaration.error));
+    }
+
+    notify("textDocument/publishDiagnostics", llvm::json::Object {
+        { "uri", uri },
+        { "diagnostics", std::move(diagnostics) }
+    });
+}
\ No newline at end of file
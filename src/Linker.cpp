@@ -0,0 +1,160 @@
+#include "../include/Linker.h"
+#include <cassert>
+#include <iostream>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include "../include/LLVMVersion.h"
+
+// set by CMakeLists.txt when LLD's libraries were found
+#ifdef CALCIUM_HAS_LLD
+#include <lld/Common/Driver.h>
+
+LLD_HAS_DRIVER(elf)
+LLD_HAS_DRIVER(coff)
+#endif
+
+/* Set by CMakeLists.txt as lists of C strings. The library directories and
+    system libraries are the ones the C++ compiler links every program with,
+    as CMake found them. */
+#ifndef CALCIUM_RUNTIME_ARCHIVE
+#define CALCIUM_RUNTIME_ARCHIVE ""
+#define CALCIUM_RUNTIME_LIBRARIES ""
+#define CALCIUM_LIBRARY_DIRECTORIES ""
+#define CALCIUM_SYSTEM_LIBRARIES ""
+#endif
+
+static const char * const runtimeLibraries[] = { CALCIUM_RUNTIME_LIBRARIES };
+static const char * const libraryDirectories[] = { CALCIUM_LIBRARY_DIRECTORIES };
+static const char * const systemLibraries[] = { CALCIUM_SYSTEM_LIBRARIES };
+
+// as in clang's Linux toolchain
+static const char * dynamicLinker(const llvm::Triple & triple) {
+    switch (triple.getArch()) {
+    case llvm::Triple::x86_64:  return "/lib64/ld-linux-x86-64.so.2";
+    case llvm::Triple::aarch64: return "/lib/ld-linux-aarch64.so.1";
+    default:                    return nullptr;
+    }
+}
+
+Linker::Linker(const std::vector<std::string> & libraries)
+    : triple(llvm::sys::getDefaultTargetTriple()) {
+    // empty lists come out as a single ""
+    if (*CALCIUM_RUNTIME_ARCHIVE) this->libraries.push_back(CALCIUM_RUNTIME_ARCHIVE);
+    for (auto library : runtimeLibraries) {
+        if (*library) this->libraries.push_back(library);
+    }
+    this->libraries.insert(this->libraries.end(), libraries.begin(), libraries.end());
+}
+
+bool Linker::available() {
+#ifdef CALCIUM_HAS_LLD
+    llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
+    if (triple.isOSBinFormatELF() || triple.isOSBinFormatCOFF()) return true;
+    std::cerr << "ERR: can't link executables for \"" << triple.str() << "\", only ELF and COFF are supported" << std::endl;
+    return false;
+#else
+    std::cerr << "ERR: calcium was built without LLD, compile without -o and link the objects with build-local.sh" << std::endl;
+    return false;
+#endif
+}
+
+Error Linker::link(const std::vector<std::string> & objects, const std::string & filename) {
+    if (!available()) return ERR_LINK;
+
+    std::vector<std::string> arguments;
+    if (triple.isOSBinFormatELF()) {
+        auto err = elfArguments(objects, filename, &arguments);
+        if (err != ERR_NONE) return err;
+    } else {
+        coffArguments(objects, filename, &arguments);
+    }
+
+    std::vector<const char *> argv;
+    for (auto & argument : arguments) {
+        argv.push_back(argument.c_str());
+    }
+
+#ifdef CALCIUM_HAS_LLD
+    // the flavor comes from argv[0], ld.lld or lld-link
+    lld::Result result = lld::lldMain(argv, llvm::outs(), llvm::errs(), {
+        { lld::Gnu, &lld::elf::link },
+        { lld::WinLink, &lld::coff::link }
+    });
+    if (result.retCode != 0) {
+        std::cerr << "ERR: could not link \"" << filename << "\"" << std::endl;
+        return ERR_LINK;
+    }
+#endif
+    return ERR_NONE;
+}
+
+/* What clang++ passes for a position independent executable. Libraries
+    are only kept when something uses them, a program that never opens a
+    window doesn't load Vulkan. */
+Error Linker::elfArguments(const std::vector<std::string> & objects, const std::string & filename, std::vector<std::string> * arguments) const {
+    assert(arguments != nullptr);
+
+    auto loader = dynamicLinker(triple);
+    if (loader == nullptr) {
+        std::cerr << "ERR: no dynamic linker known for \"" << triple.str() << "\"" << std::endl;
+        return ERR_LINK;
+    }
+
+    std::string startup[5];
+    const char * startupNames[5] = { "Scrt1.o", "crti.o", "crtbeginS.o", "crtendS.o", "crtn.o" };
+    for (int i = 0; i < 5; i++) {
+        auto err = findStartupFile(startupNames[i], &startup[i]);
+        if (err != ERR_NONE) return err;
+    }
+
+    *arguments = {
+        "ld.lld", "-pie", "--eh-frame-hdr", "--build-id", "-z", "relro", "--gc-sections",
+        "--dynamic-linker", loader, "-o", filename,
+        startup[0], startup[1], startup[2]
+    };
+    for (auto directory : libraryDirectories) {
+        if (*directory) arguments->push_back(std::string("-L") + directory);
+    }
+    arguments->insert(arguments->end(), objects.begin(), objects.end());
+
+    arguments->push_back("--as-needed");
+    arguments->insert(arguments->end(), libraries.begin(), libraries.end());
+    for (auto library : systemLibraries) {
+        if (*library) arguments->push_back(std::string("-l") + library);
+    }
+    arguments->push_back("--no-as-needed");
+
+    arguments->push_back(startup[3]);
+    arguments->push_back(startup[4]);
+    return ERR_NONE;
+}
+
+/* lld-link finds the MSVC and Windows SDK libraries itself, from LIB or
+    the installed toolchain. The runtime archive is built against the DLL
+    C runtime, which is CMake's default. */
+void Linker::coffArguments(const std::vector<std::string> & objects, const std::string & filename, std::vector<std::string> * arguments) const {
+    assert(arguments != nullptr);
+    *arguments = { "lld-link", "/nologo", "/subsystem:console", "/opt:ref", "/out:" + filename };
+    arguments->insert(arguments->end(), objects.begin(), objects.end());
+    arguments->insert(arguments->end(), libraries.begin(), libraries.end());
+
+    arguments->push_back("/defaultlib:msvcrt");
+    // printf and friends are inline in the UCRT's headers, calls from Calcium need these
+    arguments->push_back("/defaultlib:legacy_stdio_definitions");
+}
+
+Error Linker::findStartupFile(const std::string & name, std::string * path) const {
+    assert(path != nullptr);
+    for (auto directory : libraryDirectories) {
+        llvm::SmallString<128> candidate(directory);
+        llvm::sys::path::append(candidate, name);
+        if (*directory && llvm::sys::fs::exists(candidate)) {
+            *path = std::string(candidate);
+            return ERR_NONE;
+        }
+    }
+    std::cerr << "ERR: could not find \"" << name << "\" in the C++ compiler's library directories" << std::endl;
+    return ERR_LINK;
+}
\ No newline at end of file
@@ -0,0 +1,395 @@
+#include "../include/ModuleInterface.h"
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include "../include/Parser.h"
+
+static const char MAGIC[3] = { 'C', 'A', 'I' };
+static constexpr uint8_t VERSION = 1;
+static constexpr size_t HEADER_SIZE = 12;
+
+enum InterfaceKind : uint8_t {
+    INTERFACE_FUNCTION,
+    INTERFACE_KERNEL,
+    INTERFACE_STRUCT
+};
+
+// type tags past the primitives
+static constexpr uint8_t TYPE_TAG_POINTER = PRIMITIVE_BOOL + 1;
+static constexpr uint8_t TYPE_TAG_STRUCT = PRIMITIVE_BOOL + 2;
+
+// --------------------- WRITING ---------------------
+
+static void writeVarint(std::string & out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static void writeName(std::string & out, std::string_view name) {
+    writeVarint(out, static_cast<uint32_t>(name.size()));
+    out.append(name);
+}
+
+static void writeUInt32(std::string & out, uint32_t value) {
+    char bytes[4];
+    std::memcpy(bytes, &value, 4);
+    out.append(bytes, 4);
+}
+
+// pointer tags are written by a loop, as readType reads them
+static void writeType(std::string & out, const Interner & interner, const TypeAST * type) {
+    while (auto pointer = dyn_cast<PointerTypeAST>(type)) {
+        out.push_back(static_cast<char>(TYPE_TAG_POINTER));
+        type = pointer->type;
+    }
+
+    switch (type->getTypeID()) {
+    case TYPE_PRIMITIVE:
+        out.push_back(static_cast<char>(cast<PrimitiveTypeAST>(type)->primitive));
+        break;
+    case TYPE_POINTER:
+        // written above
+        break;
+    case TYPE_STRUCT:
+        out.push_back(static_cast<char>(TYPE_TAG_STRUCT));
+        writeName(out, interner.name(cast<StructTypeAST>(type)->name.symbol));
+        break;
+    }
+}
+
+static void writePrototype(
+    std::string & out, const Interner & interner, 
+    InterfaceKind kind, const FunctionPrototypeAST * prototype
+) {
+    out.push_back(static_cast<char>(kind));
+    writeName(out, interner.name(prototype->name.symbol));
+    writeVarint(out, static_cast<uint32_t>(prototype->parameters.size()));
+    for (auto & parameter : prototype->parameters) {
+        writeType(out, interner, parameter.type);
+    }
+    writeType(out, interner, prototype->returnType);
+}
+
+Error ModuleInterface::write(
+    const std::string & filename, const Interner & interner, const std::vector<const AST *> & ast
+) {
+    std::string records;
+    std::vector<uint32_t> symbols;
+    std::vector<uint32_t> offsets;
+    std::vector<bool> written(interner.size(), false);
+
+    for (auto node : ast) {
+        size_t start = records.size();
+        uint32_t symbol;
+        switch (node->getKind()) {
+        case AST_FUNCTION_DECLARATION:
+        {
+            auto declaration = cast<FunctionDeclarationAST>(node);
+            symbol = declaration->prototype->name.symbol;
+            if (written[symbol]) continue;
+            auto kind = declaration->isKernel ? INTERFACE_KERNEL : INTERFACE_FUNCTION;
+            writePrototype(records, interner, kind, declaration->prototype);
+            break;
+        }
+        case AST_FUNCTION_DEFINITION:
+        {
+            auto definition = cast<FunctionDefinitionAST>(node);
+            symbol = definition->prototype->name.symbol;
+            if (written[symbol]) continue;
+            auto kind = definition->isKernel ? INTERFACE_KERNEL : INTERFACE_FUNCTION;
+            writePrototype(records, interner, kind, definition->prototype);
+            break;
+        }
+        case AST_INCOMPLETE_STRUCT:
+        {
+            symbol = cast<IncompleteStructAST>(node)->name.symbol;
+            if (written[symbol]) continue;
+            records.push_back(static_cast<char>(INTERFACE_STRUCT));
+            writeName(records, interner.name(symbol));
+            break;
+        }
+        default:
+            // imports are not re-exported
+            continue;
+        }
+
+        written[symbol] = true;
+        symbols.push_back(symbol);
+        offsets.push_back(static_cast<uint32_t>(start));
+    }
+
+    // keep the load factor under one half, so lookups of missing names stop early
+    uint32_t tableSize = 2;
+    while (tableSize < symbols.size() * 2) tableSize *= 2;
+
+    size_t base = HEADER_SIZE + tableSize * sizeof(uint32_t);
+    if (base + records.size() > UINT32_MAX) {
+        std::cerr << "ERR: module interface \"" << filename << "\" is too large" << std::endl;
+        return ERR_WRITE_MODULE_INTERFACE;
+    }
+
+    std::vector<uint32_t> table(tableSize, 0);
+    uint32_t mask = tableSize - 1;
+    for (size_t i = 0; i < symbols.size(); i++) {
+        uint32_t slot = Interner::hash(interner.name(symbols[i])) & mask;
+        while (table[slot] != 0) slot = (slot + 1) & mask;
+        table[slot] = static_cast<uint32_t>(base + offsets[i]);
+    }
+
+    std::string out;
+    out.reserve(base + records.size());
+    out.append(MAGIC, sizeof(MAGIC));
+    out.push_back(static_cast<char>(VERSION));
+    writeUInt32(out, static_cast<uint32_t>(symbols.size()));
+    writeUInt32(out, tableSize);
+    for (auto offset : table) {
+        writeUInt32(out, offset);
+    }
+    out.append(records);
+
+    std::ofstream stream(filename, std::ios::binary);
+    stream.write(out.data(), out.size());
+    if (!stream) {
+        std::cerr << "ERR: could not write module interface \"" << filename << "\"" << std::endl;
+        return ERR_WRITE_MODULE_INTERFACE;
+    }
+
+    return ERR_NONE;
+}
+
+// --------------------- READING ---------------------
+
+/* Reads a record, failing instead of reading past the end of the file. */
+class RecordReader {
+public:
+    RecordReader(std::string_view data, size_t offset) : data(data), index(offset) {
+        failed = offset >= data.size();
+    }
+
+    bool ok() const { return !failed; }
+
+    uint8_t byte() {
+        if (index >= data.size()) {
+            failed = true;
+            return 0;
+        }
+        return static_cast<uint8_t>(data[index++]);
+    }
+
+    uint32_t varint() {
+        uint32_t value = 0;
+        for (unsigned shift = 0; shift < 35 && !failed; shift += 7) {
+            uint8_t next = byte();
+            value |= static_cast<uint32_t>(next & 0x7f) << shift;
+            if ((next & 0x80) == 0) return value;
+        }
+        failed = true;
+        return 0;
+    }
+
+    std::string_view name() {
+        uint32_t length = varint();
+        if (failed || length > data.size() - index) {
+            failed = true;
+            return std::string_view();
+        }
+        auto name = data.substr(index, length);
+        index += length;
+        return name;
+    }
+
+private:
+    std::string_view data;
+    size_t index;
+    bool failed;
+};
+
+static uint32_t readUInt32(std::string_view data, size_t offset) {
+    uint32_t value;
+    std::memcpy(&value, data.data() + offset, 4);
+    return value;
+}
+
+static Token makeName(Interner & interner, std::string_view name) {
+    return Token(TOK_IDENTIFIER, 0, static_cast<uint32_t>(name.size()), interner.intern(name));
+}
+
+// pointer tags are counted rather than recursed into, the file may be corrupt
+static const TypeAST * readType(RecordReader & reader, Interner & interner, Arena & arena) {
+    size_t pointers = 0;
+    uint8_t tag = reader.byte();
+    while (tag == TYPE_TAG_POINTER && reader.ok()) {
+        pointers++;
+        tag = reader.byte();
+    }
+
+    const TypeAST * type;
+    switch (tag) {
+    case PRIMITIVE_UNIT:
+    case PRIMITIVE_INT:
+    case PRIMITIVE_BYTE:
+    case PRIMITIVE_BOOL:
+        type = arena.make<PrimitiveTypeAST>(static_cast<Primitive>(tag));
+        break;
+    case TYPE_TAG_STRUCT:
+    {
+        auto name = reader.name();
+        if (!reader.ok() || name.empty()) return nullptr;
+        type = arena.make<StructTypeAST>(makeName(interner, name));
+        break;
+    }
+    default:
+        return nullptr;
+    }
+
+    // no deeper than the parser allows
+    if (!reader.ok() || pointers > Parser::MAX_NESTING_DEPTH) return nullptr;
+    for (size_t i = 0; i < pointers; i++) {
+        type = arena.make<PointerTypeAST>(type);
+    }
+    return type;
+}
+
+Error ModuleInterface::open(const std::string & filename) {
+    this->filename = filename;
+    auto err = file.open(filename);
+    if (err != ERR_NONE) return err;
+
+    auto data = file.text();
+    bool valid = data.size() >= HEADER_SIZE && 
+        std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) == 0 && 
+        static_cast<uint8_t>(data[3]) == VERSION;
+
+    if (valid) {
+        tableSize = readUInt32(data, 8);
+        valid = tableSize > 0 && (tableSize & (tableSize - 1)) == 0 &&
+            tableSize <= (data.size() - HEADER_SIZE) / sizeof(uint32_t);
+    }
+
+    if (!valid) {
+        std::cerr << "ERR: \"" << filename << "\" is not a module interface of this version" << std::endl;
+        return ERR_INVALID_MODULE_INTERFACE;
+    }
+
+    return ERR_NONE;
+}
+
+Error ModuleInterface::load(
+    std::string_view name, Interner & interner, Arena & arena, const AST ** declaration
+) const {
+    assert(declaration != nullptr);
+    *declaration = nullptr;
+
+    auto data = file.text();
+    uint32_t mask = tableSize - 1;
+    uint32_t slot = Interner::hash(name) & mask;
+    for (uint32_t probes = 0; probes < tableSize; probes++, slot = (slot + 1) & mask) {
+        uint32_t offset = readUInt32(data, HEADER_SIZE + slot * sizeof(uint32_t));
+        if (offset == 0) return ERR_NONE;
+
+        RecordReader reader(data, offset);
+        uint8_t kind = reader.byte();
+        auto recordName = reader.name();
+        if (!reader.ok()) break;
+        if (recordName != name) continue;
+
+        if (kind == INTERFACE_STRUCT) {
+            *declaration = arena.make<IncompleteStructAST>(makeName(interner, name));
+            return ERR_NONE;
+        }
+
+        if (kind != INTERFACE_FUNCTION && kind != INTERFACE_KERNEL) break;
+
+        // bounded by the bytes left, every parameter takes at least one
+        uint32_t count = reader.varint();
+        if (!reader.ok() || count > data.size() - offset) break;
+
+        std::vector<Parameter> parameters;
+        parameters.reserve(count);
+        for (uint32_t i = 0; i < count && reader.ok(); i++) {
+            auto type = readType(reader, interner, arena);
+            if (type == nullptr) break;
+            parameters.push_back({ Token(), type });
+        }
+        auto returnType = readType(reader, interner, arena);
+        if (!reader.ok() || parameters.size() != count || returnType == nullptr) break;
+
+        auto prototype = arena.make<FunctionPrototypeAST>(
+            makeName(interner, name), arena.take(parameters, 0), returnType
+        );
+        *declaration = arena.make<FunctionDeclarationAST>(prototype, kind == INTERFACE_KERNEL);
+        return ERR_NONE;
+    }
+
+    std::cerr << "ERR: module interface \"" << filename << "\" is corrupt" << std::endl;
+    return ERR_INVALID_MODULE_INTERFACE;
+}
+
+// --------------------- IMPORTS ---------------------
+
+static uint32_t declaredSymbol(const AST * node) {
+    switch (node->getKind()) {
+    case AST_FUNCTION_DECLARATION:
+        return cast<FunctionDeclarationAST>(node)->prototype->name.symbol;
+    case AST_FUNCTION_DEFINITION:
+        return cast<FunctionDefinitionAST>(node)->prototype->name.symbol;
+    case AST_INCOMPLETE_STRUCT:
+        return cast<IncompleteStructAST>(node)->name.symbol;
+    default:
+        return Interner::NO_SYMBOL;
+    }
+}
+
+Error ModuleInterface::resolve(
+    const std::string & directory, Interner & interner, 
+    Arena & arena, std::vector<const AST *> & ast
+) {
+    std::vector<std::unique_ptr<ModuleInterface>> modules;
+    std::vector<bool> imported(interner.size(), false);
+    std::vector<bool> declared(interner.size(), false);
+    std::vector<const AST *> declarations;
+
+    for (auto node : ast) {
+        if (auto import = dyn_cast<ImportAST>(node)) {
+            auto symbol = import->name.symbol;
+            if (imported[symbol]) continue;
+            imported[symbol] = true;
+
+            modules.push_back(std::make_unique<ModuleInterface>());
+            auto err = modules.back()->open(directory + std::string(interner.name(symbol)) + ".cai");
+            if (err != ERR_NONE) return err;
+        } else {
+            declared[declaredSymbol(node)] = true;
+            declarations.push_back(node);
+        }
+    }
+
+    if (modules.empty()) return ERR_NONE;
+
+    // struct names in imported prototypes are interned as they load, and looked up in turn
+    std::vector<const AST *> result;
+    for (uint32_t symbol = 1; symbol < interner.size(); symbol++) {
+        if (symbol < declared.size() && declared[symbol]) continue;
+
+        auto name = interner.name(symbol);
+        for (auto & module : modules) {
+            const AST * declaration;
+            auto err = module->load(name, interner, arena, &declaration);
+            if (err != ERR_NONE) return err;
+
+            if (declaration != nullptr) {
+                result.push_back(declaration);
+                break;
+            }
+        }
+    }
+
+    result.insert(result.end(), declarations.begin(), declarations.end());
+    ast = std::move(result);
+    return ERR_NONE;
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "../include/ObjectCache.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+#include "../include/LLVMVersion.h"
+#include "../include/ASTVisitor.h"
+#include "../include/IRGenerator.h"
+
+// --------------------- KEYS ---------------------
+/* Hashes everything the generated code depends on. Types are spelled out,
+    TypeTable indices change from one build to the next. Every node starts
+    with its kind and every list with its length, so two different
+    definitions never feed the hash the same bytes. */
+class ObjectCache::KeyBuilder : public ASTVisitor<KeyBuilder> {
+public:
+    KeyBuilder(const ObjectCache & cache) : cache(cache) {}
+
+    std::string key() {
+        return llvm::toHex(hasher.final(), true);
+    }
+
+    void add(uint32_t value) {
+        hasher.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(&value), sizeof(value)));
+    }
+
+    void add(std::string_view text) {
+        add(uint32_t(text.size()));
+        hasher.update(llvm::StringRef(text.data(), text.size()));
+    }
+
+    void addName(const Token & token) {
+        add(token.symbol != Interner::NO_SYMBOL ? cache.interner.name(token.symbol) : cache.program.extract(token));
+    }
+
+    void addType(uint32_t type) {
+        add(cache.types.name(type, cache.interner));
+    }
+
+    void addExpression(const ExpressionAST * expression) {
+        add(expression->getKind());
+        addType(expression->type);
+    }
+
+    // a callee's signature, changing it changes the call
+    void add(const FunctionPrototypeAST * prototype) {
+        addName(prototype->name);
+        add(uint32_t(prototype->parameters.size()));
+        for (auto & parameter : prototype->parameters) {
+            addType(parameter.type->resolved);
+        }
+        addType(prototype->returnType->resolved);
+    }
+
+    void add(const BodyAST * body) {
+        add(uint32_t(body->statements.size()));
+        for (auto statement : body->statements) {
+            visit(statement);
+        }
+    }
+
+    void visitFunctionDefinition(const FunctionDefinitionAST * definition) {
+        add(definition->getKind());
+        add(definition->isKernel);
+        add(definition->isMultiversioned);
+        add(definition->prototype);
+        add(definition->slotCount);
+        add(definition->body);
+    }
+
+    void visitVariableDefinition(const VariableDefinitionAST * definition) {
+        add(definition->getKind());
+        add(definition->slot);
+        addType(definition->type->resolved);
+        visit(definition->expression);
+    }
+
+    void visitWhileLoop(const WhileLoopAST * whileLoop) {
+        add(whileLoop->getKind());
+        visit(whileLoop->condition);
+        add(whileLoop->body);
+    }
+
+    void visitReturn(const ReturnAST * returnStatement) {
+        add(returnStatement->getKind());
+        visit(returnStatement->expression);
+    }
+
+    void visitVariable(const VariableAST * variable) {
+        addExpression(variable);
+        add(variable->slot);
+        if (variable->slot == VariableAST::GLOBAL) {
+            add(cache.prototypes[variable->text.symbol]);
+        }
+    }
+
+    void visitIntLiteral(const IntLiteralAST * literal) {
+        addExpression(literal);
+        add(literal->value);
+    }
+
+    void visitFloatLiteral(const FloatLiteralAST * literal) {
+        addExpression(literal);
+        uint32_t bits;
+        std::memcpy(&bits, &literal->value, sizeof(bits));
+        add(bits);
+    }
+
+    void visitStringLiteral(const StringLiteralAST * literal) {
+        addExpression(literal);
+        addName(literal->text);
+    }
+
+    void visitFunctionCall(const FunctionCallAST * call) {
+        addExpression(call);
+        add(cache.prototypes[call->name.symbol]);
+        add(uint32_t(call->arguments.size()));
+        for (auto argument : call->arguments) {
+            visit(argument);
+        }
+    }
+
+    void visitNotOperation(const NotOperationAST * operation) {
+        addPrefixRun(operation);
+    }
+
+    void visitNegation(const NegationAST * negation) {
+        addPrefixRun(negation);
+    }
+
+    // prefix runs are walked with a loop too, in the order recursion would add them
+    void addPrefixRun(const ExpressionAST * expression) {
+        while (auto operand = prefixOperand(expression)) {
+            addExpression(expression);
+            expression = operand;
+        }
+        visit(expression);
+    }
+
+    // left operands are walked with a loop, as in the IRGenerator
+    void visitBinaryOperation(const BinaryOperationAST * operation) {
+        std::vector<const BinaryOperationAST *> chain;
+        const ExpressionAST * innermost = operation;
+        while (auto binary = dyn_cast<BinaryOperationAST>(innermost)) {
+            chain.push_back(binary);
+            innermost = binary->left;
+        }
+
+        addExpression(operation);
+        add(uint32_t(chain.size()));
+        visit(innermost);
+        for (auto link = chain.rbegin(); link != chain.rend(); ++link) {
+            addType((*link)->type);
+            add((*link)->op);
+            visit((*link)->right);
+        }
+    }
+
+private:
+    const ObjectCache & cache;
+    llvm::SHA1 hasher;
+};
+
+
+// --------------------- CACHE ---------------------
+ObjectCache::ObjectCache(
+    Program & program,
+    const Interner & interner,
+    const TypeTable & types,
+    const OutputOptions & options,
+    const std::string & directory
+) : program(program), interner(interner), types(types), options(options), directory(directory) {}
+
+std::string ObjectCache::key(const FunctionDefinitionAST * definition) const {
+    KeyBuilder builder(*this);
+    builder.add(VERSION);
+    builder.add(LLVM_VERSION_STRING);
+    builder.add(llvm::sys::getDefaultTargetTriple());
+    builder.add(options.cpu);
+    builder.add(options.features);
+    builder.add(options.optimization);
+    builder.add(options.functionSections);
+    builder.visit(definition);
+    return builder.key();
+}
+
+Error ObjectCache::build(const std::vector<const AST *> & ast, unsigned jobs, std::vector<std::string> * objects, size_t * compiled) {
+    assert(objects != nullptr && compiled != nullptr);
+
+    if (auto err = llvm::sys::fs::create_directories(directory)) {
+        std::cerr << "ERR: could not create cache directory \"" << directory << "\", " << err.message() << std::endl;
+        return ERR_OUTPUT_OBJECT_FILE;
+    }
+
+    prototypes.assign(interner.size(), nullptr);
+    std::vector<const FunctionDefinitionAST *> definitions;
+    for (auto node : ast) {
+        if (auto declaration = dyn_cast<FunctionDeclarationAST>(node)) {
+            prototypes[declaration->prototype->name.symbol] = declaration->prototype;
+        } else if (auto definition = dyn_cast<FunctionDefinitionAST>(node)) {
+            prototypes[definition->prototype->name.symbol] = definition->prototype;
+            definitions.push_back(definition);
+        }
+    }
+
+    objects->clear();
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < definitions.size(); i++) {
+        llvm::SmallString<128> path(directory);
+        llvm::sys::path::append(path, key(definitions[i]) + ".o");
+        objects->push_back(std::string(path));
+        if (!llvm::sys::fs::exists(path)) {
+            missing.push_back(i);
+        }
+    }
+    *compiled = missing.size();
+
+    // pass timers are shared, so timed definitions are compiled one at a time
+    size_t chunkCount = std::min<size_t>(options.timePasses ? 1 : jobs, missing.size());
+    std::vector<Error> results(chunkCount, ERR_NONE);
+    auto compileChunk = [&](size_t i) {
+        size_t begin = missing.size() * i / chunkCount;
+        size_t end = missing.size() * (i + 1) / chunkCount;
+        for (size_t j = begin; j < end && results[i] == ERR_NONE; j++) {
+            results[i] = compile(ast, definitions[missing[j]], (*objects)[missing[j]]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < chunkCount; i++) {
+        threads.emplace_back(compileChunk, i);
+    }
+    if (chunkCount > 0) compileChunk(0);
+    for (auto & thread : threads) thread.join();
+
+    for (auto result : results) {
+        if (result != ERR_NONE) return result;
+    }
+    return ERR_NONE;
+}
+
+/* Every definition gets a context of its own, so they can be compiled on
+    any thread. Objects are written under a unique name and then renamed,
+    so a build running at the same time never links half an object. */
+Error ObjectCache::compile(const std::vector<const AST *> & ast, const FunctionDefinitionAST * definition, const std::string & path) const {
+    llvm::LLVMContext llvmContext;
+    llvm::Module llvmModule("Calcium", llvmContext);
+
+    IRGenerator irGenerator(program, interner, types, llvmContext, llvmModule);
+    irGenerator.generate(ast, definition);
+
+    llvm::SmallString<128> temporary;
+    llvm::sys::fs::createUniquePath(path + ".%%%%%%", temporary, false);
+
+    Writer writer(llvmModule, options);
+    auto err = writer.output(std::string(temporary));
+    if (err != ERR_NONE) {
+        llvm::sys::fs::remove(temporary);
+        return err;
+    }
+
+    if (auto renamed = llvm::sys::fs::rename(temporary, path)) {
+        std::cerr << "ERR: could not move \"" << temporary.c_str() << "\" into the cache, " << renamed.message() << std::endl;
+        llvm::sys::fs::remove(temporary);
+        return ERR_OUTPUT_OBJECT_FILE;
+    }
+    return ERR_NONE;
+}
+
+Error ObjectCache::writeResponseFile(const std::string & filename, const std::vector<std::string> & objects) {
+    std::error_code err;
+    llvm::raw_fd_ostream file(filename, err, llvm::sys::fs::OF_Text);
+    if (err) {
+        std::cerr << "ERR: could not open output file \"" << filename << "\", " << err.message() << std::endl;
+        return ERR_OUTPUT_OBJECT_FILE;
+    }
+
+    // forward slashes in quotes read the same to every linker driver
+    for (auto & object : objects) {
+        llvm::SmallString<128> path(object);
+        llvm::sys::path::native(path, llvm::sys::path::Style::posix);
+        file << "\"" << path << "\"\n";
+    }
+    return ERR_NONE;
+}
\ No newline at end of file
@@ -75,16 +75,16 @@ std::vector<uint32_t> SPIRVGenerator::generate(const FunctionDefinitionAST * def
     emit<OP_DECORATE>({
         outputVariable,
         DEC_LOCATION,
-        0 // location = 0
+        0u // location = 0
     });
     // Type declarations
     emit<OP_TYPE_VOID>({ voidType = requestId() });
     emit<OP_TYPE_FUNCTION>({ entryFunctionType = requestId(), voidType });
-    emit<OP_TYPE_FLOAT>({ floatType = requestId(), 32 /* bits */ });
+    emit<OP_TYPE_FLOAT>({ floatType = requestId(), 32u /* bits */ });
     emit<OP_TYPE_VECTOR>({
         vec4Type = requestId(),
         floatType,
-        4 // components
+        4u // components
     });
 
     spirv_id outputPointerType;
@@ -123,7 +123,7 @@ std::vector<uint32_t> SPIRVGenerator::generate(const FunctionDefinitionAST * def
     result.insert(result.end(), constantSection.begin(), constantSection.end());
     result.insert(result.end(), codeSection.begin(), codeSection.end());
 
-    std::ofstream fs(name + ".spv", std::ios::out | std::ios::binary);
+    std::ofstream fs(std::string(name) + ".spv", std::ios::out | std::ios::binary);
     fs.write(reinterpret_cast<const char *>(result.data()), result.size() * 4);
     fs.close();
 
@@ -132,10 +132,9 @@ std::vector<uint32_t> SPIRVGenerator::generate(const FunctionDefinitionAST * def
     return result;
 }
 
-void SPIRVGenerator::generate(const std::unique_ptr<BodyAST> & body) {
+void SPIRVGenerator::generate(const BodyAST * body) {
     for (auto & statement : body->statements) {
-        if (statement->isReturn()) {
-            auto returnStatement = reinterpret_cast<const ReturnAST *>(statement.get());
+        if (auto returnStatement = dyn_cast<ReturnAST>(statement)) {
             emit<OP_STORE>({
                 outputVariable, 
                 generate(returnStatement->expression)
@@ -144,11 +143,11 @@ void SPIRVGenerator::generate(const std::unique_ptr<BodyAST> & body) {
     }
 }
 
-spirv_id SPIRVGenerator::generate(const std::unique_ptr<ExpressionAST> & expression) {
-    switch (expression->getExpressionID()) {
-        case EXPRESSION_FUNCTION_CALL:
+spirv_id SPIRVGenerator::generate(const ExpressionAST * expression) {
+    switch (expression->getKind()) {
+        case AST_FUNCTION_CALL:
         {
-            auto functionCall = reinterpret_cast<const FunctionCallAST *>(expression.get());
+            auto functionCall = cast<FunctionCallAST>(expression);
             auto name = program.extract(functionCall->name);
             assert(name == "vec4");
             // TODO: handle other function calls and constructors
@@ -163,29 +162,119 @@ spirv_id SPIRVGenerator::generate(const std::unique_ptr<ExpressionAST> & express
 
             emit<OP_COMPOSITE_CONSTRUCT>(std::move(words));
 
-            return id;
+            return setType(id, vec4Type);
         }
-        case EXPRESSION_FLOAT_LITERAL:
+        case AST_FLOAT_LITERAL:
         {
             // TODO: cache re-used constants
             static_assert(sizeof(float) == sizeof(uint32_t)); // TODO: support other sizes
 
-            auto floatLiteral = reinterpret_cast<const FloatLiteralAST *>(expression.get());
-            float value = std::stof(program.extract(floatLiteral->text));
+            auto floatLiteral = cast<FloatLiteralAST>(expression);
+            float value = floatLiteral->value;
             const uint32_t * data = reinterpret_cast<const uint32_t *>(&value);
 
             spirv_id id = requestId();
             emit<OP_CONSTANT>({ floatType, id, *data });
 
+            return setType(id, floatType);
+        }
+        case AST_NEGATION:
+        {
+            // a run of negations is applied innermost first, with a loop
+            size_t count = 0;
+            const ExpressionAST * innermost = expression;
+            while (auto negation = dyn_cast<NegationAST>(innermost)) {
+                innermost = negation->expression;
+                count++;
+            }
+
+            spirv_id id = generate(innermost);
+            spirv_id type = typeOf(id);
+            for (size_t i = 0; i < count; i++) {
+                spirv_id negated = requestId();
+                emit<OP_F_NEGATE>({ type, negated, id });
+                id = setType(negated, type);
+            }
             return id;
         }
-        break;
+        case AST_BINARY_OPERATION:
+            return generate(cast<BinaryOperationAST>(expression));
         default:
             assert(false);
     }
     return -1;
 }
 
+// left operands are walked with a loop, long chains nest as deep as they are long
+spirv_id SPIRVGenerator::generate(const BinaryOperationAST * operation) {
+    std::vector<const BinaryOperationAST *> chain;
+    const ExpressionAST * innermost = operation;
+    while (auto binary = dyn_cast<BinaryOperationAST>(innermost)) {
+        chain.push_back(binary);
+        innermost = binary->left;
+    }
+
+    spirv_id value = generate(innermost);
+    for (auto link = chain.rbegin(); link != chain.rend(); ++link) {
+        value = generate(*link, value, generate((*link)->right));
+    }
+    return value;
+}
+
+spirv_id SPIRVGenerator::generate(const BinaryOperationAST * operation, spirv_id left, spirv_id right) {
+    spirv_id leftType = typeOf(left);
+    spirv_id rightType = typeOf(right);
+
+    spirv_id id = requestId();
+
+    // vec4 * float scales every component
+    if (operation->op == BINARY_MULTIPLY && leftType != rightType) {
+        bool isLeftVector = leftType == vec4Type;
+        assert((isLeftVector ? rightType : leftType) == floatType);
+        emit<OP_VECTOR_TIMES_SCALAR>({
+            vec4Type, id,
+            isLeftVector ? left : right,
+            isLeftVector ? right : left
+        });
+        return setType(id, vec4Type);
+    }
+
+    // operators and operand types were checked by the Analyzer
+    assert(leftType == rightType);
+
+    switch (operation->op) {
+    case BINARY_ADD:
+        emit<OP_F_ADD>({ leftType, id, left, right });
+        break;
+    case BINARY_SUBTRACT:
+        emit<OP_F_SUB>({ leftType, id, left, right });
+        break;
+    case BINARY_MULTIPLY:
+        emit<OP_F_MUL>({ leftType, id, left, right });
+        break;
+    case BINARY_DIVIDE:
+        emit<OP_F_DIV>({ leftType, id, left, right });
+        break;
+    case BINARY_REMAINDER:
+        emit<OP_F_REM>({ leftType, id, left, right });
+        break;
+    default:
+        assert(false);
+    }
+
+    return setType(id, leftType);
+}
+
 spirv_id SPIRVGenerator::requestId() {
     return ++ids;
+}
+
+spirv_id SPIRVGenerator::setType(spirv_id id, spirv_id type) {
+    if (types.size() <= id) types.resize(id + 1, 0);
+    types[id] = type;
+    return id;
+}
+
+spirv_id SPIRVGenerator::typeOf(spirv_id id) const {
+    return id < types.size() ? types[id] : 0;
 }
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "../include/Scanner.h"
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SCANNER_X86_64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(SCANNER_X86_64) && !defined(_MSC_VER)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+static inline bool isWhitespace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool isAlphanumeric(char c) {
+    auto lower = static_cast<unsigned char>(c | 0x20);
+    return static_cast<unsigned char>(lower - 'a') < 26 || static_cast<unsigned char>(c - '0') < 10;
+}
+
+
+// --------------------- SCALAR ---------------------
+static const char * scanWhitespaceScalar(const char * p, const char * end) {
+    while (p < end && isWhitespace(*p)) p++;
+    return p;
+}
+
+static const char * scanNewlineScalar(const char * p, const char * end) {
+    while (p < end && *p != '\n') p++;
+    return p;
+}
+
+static const char * scanQuoteOrNewlineScalar(const char * p, const char * end) {
+    while (p < end && *p != '"' && *p != '\n') p++;
+    return p;
+}
+
+static const char * scanAlphanumericScalar(const char * p, const char * end) {
+    while (p < end && isAlphanumeric(*p)) p++;
+    return p;
+}
+
+
+#ifdef SCANNER_X86_64
+
+static inline unsigned lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+/* Byte ranges are tested with signed compares: adding (0x80 - low) moves
+    [low, high] to the bottom of the signed range, so "in range" becomes
+    "less than -128 + (high - low + 1)". */
+static inline char rangeBias(char low) {
+    return static_cast<char>(0x80 - low);
+}
+
+static inline char rangeLimit(int size) {
+    return static_cast<char>(-128 + size);
+}
+
+
+// --------------------- SSE2 ---------------------
+static const char * scanWhitespaceSSE2(const char * p, const char * end) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i controlBias = _mm_set1_epi8(rangeBias('\t'));
+    const __m128i controlLimit = _mm_set1_epi8(rangeLimit('\r' - '\t' + 1));
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i control = _mm_cmplt_epi8(_mm_add_epi8(chunk, controlBias), controlLimit);
+        __m128i whitespace = _mm_or_si128(_mm_cmpeq_epi8(chunk, space), control);
+
+        uint32_t mask = _mm_movemask_epi8(whitespace);
+        if (mask != 0xFFFF) return p + lowestBit(~mask);
+        p += 16;
+    }
+
+    return scanWhitespaceScalar(p, end);
+}
+
+static const char * scanNewlineSSE2(const char * p, const char * end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        if (mask != 0) return p + lowestBit(mask);
+        p += 16;
+    }
+
+    return scanNewlineScalar(p, end);
+}
+
+static const char * scanQuoteOrNewlineSSE2(const char * p, const char * end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, newline));
+        uint32_t mask = _mm_movemask_epi8(stop);
+        if (mask != 0) return p + lowestBit(mask);
+        p += 16;
+    }
+
+    return scanQuoteOrNewlineScalar(p, end);
+}
+
+static const char * scanAlphanumericSSE2(const char * p, const char * end) {
+    const __m128i lowercase = _mm_set1_epi8(0x20);
+    const __m128i letterBias = _mm_set1_epi8(rangeBias('a'));
+    const __m128i letterLimit = _mm_set1_epi8(rangeLimit(26));
+    const __m128i digitBias = _mm_set1_epi8(rangeBias('0'));
+    const __m128i digitLimit = _mm_set1_epi8(rangeLimit(10));
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i lower = _mm_or_si128(chunk, lowercase);
+        __m128i letter = _mm_cmplt_epi8(_mm_add_epi8(lower, letterBias), letterLimit);
+        __m128i digit = _mm_cmplt_epi8(_mm_add_epi8(chunk, digitBias), digitLimit);
+
+        uint32_t mask = _mm_movemask_epi8(_mm_or_si128(letter, digit));
+        if (mask != 0xFFFF) return p + lowestBit(~mask);
+        p += 16;
+    }
+
+    return scanAlphanumericScalar(p, end);
+}
+
+
+// --------------------- AVX2 ---------------------
+TARGET_AVX2 static const char * scanWhitespaceAVX2(const char * p, const char * end) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i controlBias = _mm256_set1_epi8(rangeBias('\t'));
+    const __m256i controlLimit = _mm256_set1_epi8(rangeLimit('\r' - '\t' + 1));
+
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i control = _mm256_cmpgt_epi8(controlLimit, _mm256_add_epi8(chunk, controlBias));
+        __m256i whitespace = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), control);
+
+        uint32_t mask = _mm256_movemask_epi8(whitespace);
+        if (mask != 0xFFFFFFFF) return p + lowestBit(~mask);
+        p += 32;
+    }
+
+    return scanWhitespaceSSE2(p, end);
+}
+
+TARGET_AVX2 static const char * scanNewlineAVX2(const char * p, const char * end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline));
+        if (mask != 0) return p + lowestBit(mask);
+        p += 32;
+    }
+
+    return scanNewlineSSE2(p, end);
+}
+
+TARGET_AVX2 static const char * scanQuoteOrNewlineAVX2(const char * p, const char * end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, newline));
+        uint32_t mask = _mm256_movemask_epi8(stop);
+        if (mask != 0) return p + lowestBit(mask);
+        p += 32;
+    }
+
+    return scanQuoteOrNewlineSSE2(p, end);
+}
+
+TARGET_AVX2 static const char * scanAlphanumericAVX2(const char * p, const char * end) {
+    const __m256i lowercase = _mm256_set1_epi8(0x20);
+    const __m256i letterBias = _mm256_set1_epi8(rangeBias('a'));
+    const __m256i letterLimit = _mm256_set1_epi8(rangeLimit(26));
+    const __m256i digitBias = _mm256_set1_epi8(rangeBias('0'));
+    const __m256i digitLimit = _mm256_set1_epi8(rangeLimit(10));
+
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i lower = _mm256_or_si256(chunk, lowercase);
+        __m256i letter = _mm256_cmpgt_epi8(letterLimit, _mm256_add_epi8(lower, letterBias));
+        __m256i digit = _mm256_cmpgt_epi8(digitLimit, _mm256_add_epi8(chunk, digitBias));
+
+        uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(letter, digit));
+        if (mask != 0xFFFFFFFF) return p + lowestBit(~mask);
+        p += 32;
+    }
+
+    return scanAlphanumericSSE2(p, end);
+}
+
+static bool hostSupportsAVX2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // the OS must also save the upper halves of the YMM registers
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // SCANNER_X86_64
+
+
+// --------------------- DISPATCH ---------------------
+struct ScanKernels {
+    decltype(&scanWhitespaceScalar) whitespace;
+    decltype(&scanNewlineScalar) newline;
+    decltype(&scanQuoteOrNewlineScalar) quoteOrNewline;
+    decltype(&scanAlphanumericScalar) alphanumeric;
+};
+
+static bool hostSupports(ScannerWidth width) {
+    switch (width) {
+    case SCANNER_SCALAR:
+        return true;
+#ifdef SCANNER_X86_64
+    // SSE2 is part of the x86-64 baseline
+    case SCANNER_SSE2:
+        return true;
+    case SCANNER_AVX2:
+        return hostSupportsAVX2();
+#endif
+    default:
+        return false;
+    }
+}
+
+static ScanKernels kernelsFor(ScannerWidth width) {
+    switch (width) {
+#ifdef SCANNER_X86_64
+    case SCANNER_AVX2:
+        return { scanWhitespaceAVX2, scanNewlineAVX2, scanQuoteOrNewlineAVX2, scanAlphanumericAVX2 };
+    case SCANNER_SSE2:
+        return { scanWhitespaceSSE2, scanNewlineSSE2, scanQuoteOrNewlineSSE2, scanAlphanumericSSE2 };
+#endif
+    default:
+        return { scanWhitespaceScalar, scanNewlineScalar, scanQuoteOrNewlineScalar, scanAlphanumericScalar };
+    }
+}
+
+static ScanKernels selectKernels() {
+    if (hostSupports(SCANNER_AVX2)) return kernelsFor(SCANNER_AVX2);
+    if (hostSupports(SCANNER_SSE2)) return kernelsFor(SCANNER_SSE2);
+    return kernelsFor(SCANNER_SCALAR);
+}
+
+static ScanKernels kernels = selectKernels();
+
+bool selectScanner(ScannerWidth width) {
+    if (!hostSupports(width)) return false;
+    kernels = kernelsFor(width);
+    return true;
+}
+
+const char * scanWhitespace(const char * begin, const char * end) {
+    return kernels.whitespace(begin, end);
+}
+
+const char * scanNewline(const char * begin, const char * end) {
+    return kernels.newline(begin, end);
+}
+
+const char * scanQuoteOrNewline(const char * begin, const char * end) {
+    return kernels.quoteOrNewline(begin, end);
+}
+
+const char * scanAlphanumeric(const char * begin, const char * end) {
+    return kernels.alphanumeric(begin, end);
+}
@@ -0,0 +1,147 @@
+#include "../include/SourceBuffer.h"
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char EMPTY[1] = { '\0' };
+
+SourceBuffer::~SourceBuffer() {
+    close();
+}
+
+Error SourceBuffer::open(const std::string & filename) {
+    close();
+
+    if (!map(filename) && !read(filename)) {
+        std::cerr << "ERR: could not read file " << filename << std::endl;
+        return ERR_READ_SOURCE_FILE;
+    }
+
+    // tokens store 32-bit offsets
+    if (size > UINT32_MAX) {
+        std::cerr << "ERR: source files larger than 4 GiB are not supported" << std::endl;
+        close();
+        return ERR_SOURCE_TOO_LARGE;
+    }
+
+    return ERR_NONE;
+}
+
+std::string_view SourceBuffer::text() const {
+    return data == nullptr ? std::string_view(EMPTY, 0) : std::string_view(data, size);
+}
+
+#ifdef _WIN32
+
+bool SourceBuffer::map(const std::string & filename) {
+    HANDLE file = CreateFileA(
+        filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, 
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    LARGE_INTEGER fileSize;
+    // a file filling its last page has no room for the sentinel
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || 
+        fileSize.QuadPart % info.dwPageSize == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) return false;
+
+    // the view keeps the mapping alive
+    void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr) return false;
+
+    data = static_cast<const char *>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    mapped = true;
+    return true;
+}
+
+void SourceBuffer::close() {
+    if (mapped) {
+        UnmapViewOfFile(data);
+    }
+    buffer.reset();
+    data = nullptr;
+    size = 0;
+    mapped = false;
+}
+
+#else
+
+bool SourceBuffer::map(const std::string & filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat status;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    // a file filling its last page has no room for the sentinel
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) || 
+        status.st_size == 0 || status.st_size % pageSize == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    void * view = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+
+    madvise(view, status.st_size, MADV_SEQUENTIAL);
+
+    data = static_cast<const char *>(view);
+    size = static_cast<size_t>(status.st_size);
+    mapped = true;
+    return true;
+}
+
+void SourceBuffer::close() {
+    if (mapped) {
+        munmap(const_cast<char *>(data), size);
+    }
+    buffer.reset();
+    data = nullptr;
+    size = 0;
+    mapped = false;
+}
+
+#endif
+
+bool SourceBuffer::read(const std::string & filename) {
+    std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+    if (!stream) return false;
+
+    auto fileSize = static_cast<size_t>(stream.tellg());
+    stream.seekg(0);
+
+    buffer = std::make_unique<char[]>(fileSize + 1);
+    if (!stream.read(buffer.get(), fileSize)) {
+        buffer.reset();
+        return false;
+    }
+    buffer[fileSize] = '\0';
+
+    data = buffer.get();
+    size = fileSize;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "../include/TokenStream.h"
+#include <cassert>
+
+TokenStream::TokenStream(Lexer & lexer) 
+: lexer(&lexer), buffer(nullptr), types(WINDOW), offsets(WINDOW), lengths(WINDOW), symbols(WINDOW) {
+    begin = 0;
+    end = 0;
+    lexed = 0;
+    err = ERR_NONE;
+}
+
+TokenStream::TokenStream(const TokenBuffer & tokens, size_t begin, size_t end)
+: lexer(nullptr), buffer(&tokens), begin(begin), end(end) {
+    assert(begin <= end && end <= tokens.size());
+    lexed = 0;
+    err = ERR_NONE;
+
+    uint32_t offset = end > 0 ? tokens[end - 1].offset + tokens[end - 1].length : 0;
+    last = Token(TOK_EOF, offset, 0);
+}
+
+TokenType TokenStream::type(size_t index) {
+    if (buffer != nullptr) {
+        return begin + index < end ? buffer->type(begin + index) : TOK_EOF;
+    }
+
+    if (!fill(index)) return TOK_EOF;
+    return static_cast<TokenType>(types[index & (WINDOW - 1)]);
+}
+
+Token TokenStream::get(size_t index) {
+    if (buffer != nullptr) {
+        return begin + index < end ? (*buffer)[begin + index] : last;
+    }
+
+    if (!fill(index)) return last;
+
+    size_t slot = index & (WINDOW - 1);
+    return Token(static_cast<TokenType>(types[slot]), offsets[slot], lengths[slot], symbols[slot]);
+}
+
+Error TokenStream::error() const {
+    return err;
+}
+
+/* Lexes up to and including index, returns false if the stream ends first. */
+bool TokenStream::fill(size_t index) {
+    while (index >= lexed) {
+        if (last.type == TOK_EOF) return false;
+
+        Token token;
+        err = lexer->next(&token);
+        if (err != ERR_NONE) {
+            last = Token(TOK_EOF, 0, 0);
+            return false;
+        }
+
+        if (token.type == TOK_EOF) {
+            last = token;
+            return false;
+        }
+
+        size_t slot = lexed & (WINDOW - 1);
+        types[slot] = static_cast<uint8_t>(token.type);
+        offsets[slot] = token.offset;
+        lengths[slot] = token.length;
+        symbols[slot] = token.symbol;
+        lexed++;
+    }
+
+    // the token has already been overwritten
+    assert(lexed - index <= WINDOW);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "../include/TypeTable.h"
+#include <cassert>
+
+TypeTable::TypeTable() {
+    types.push_back({ TYPE_PRIMITIVE, 0, NO_TYPE }); // NO_TYPE
+    for (auto primitive : { PRIMITIVE_UNIT, PRIMITIVE_INT, PRIMITIVE_BYTE, PRIMITIVE_BOOL }) {
+        assert(types.size() == TypeTable::primitive(primitive));
+        types.push_back({ TYPE_PRIMITIVE, static_cast<uint32_t>(primitive), NO_TYPE });
+    }
+}
+
+uint32_t TypeTable::pointer(uint32_t pointee) {
+    assert(pointee != NO_TYPE && pointee < types.size());
+    if (types[pointee].pointer == NO_TYPE) {
+        types[pointee].pointer = static_cast<uint32_t>(types.size());
+        types.push_back({ TYPE_POINTER, pointee, NO_TYPE });
+    }
+    return types[pointee].pointer;
+}
+
+uint32_t TypeTable::structure(uint32_t symbol) {
+    assert(symbol != Interner::NO_SYMBOL);
+    if (symbol >= structs.size()) {
+        structs.resize(symbol + 1, NO_TYPE);
+    }
+    if (structs[symbol] == NO_TYPE) {
+        structs[symbol] = static_cast<uint32_t>(types.size());
+        types.push_back({ TYPE_STRUCT, symbol, NO_TYPE });
+    }
+    return structs[symbol];
+}
+
+TypeID TypeTable::id(uint32_t type) const {
+    assert(type != NO_TYPE && type < types.size());
+    return types[type].id;
+}
+
+bool TypeTable::isPrimitive(uint32_t type, Primitive primitive) const {
+    return type == TypeTable::primitive(primitive);
+}
+
+Primitive TypeTable::primitiveOf(uint32_t type) const {
+    assert(id(type) == TYPE_PRIMITIVE);
+    return static_cast<Primitive>(types[type].operand);
+}
+
+uint32_t TypeTable::pointee(uint32_t type) const {
+    assert(id(type) == TYPE_POINTER);
+    return types[type].operand;
+}
+
+uint32_t TypeTable::symbol(uint32_t type) const {
+    assert(id(type) == TYPE_STRUCT);
+    return types[type].operand;
+}
+
+size_t TypeTable::size() const {
+    return types.size();
+}
+
+std::string TypeTable::name(uint32_t type, const Interner & interner) const {
+    if (type == NO_TYPE) return "<error>";
+
+    std::string name;
+    while (id(type) == TYPE_POINTER) {
+        name += "* ";
+        type = pointee(type);
+    }
+
+    if (id(type) == TYPE_STRUCT) {
+        name += interner.name(symbol(type));
+        return name;
+    }
+
+    switch (primitiveOf(type)) {
+    case PRIMITIVE_UNIT: return name + "unit";
+    case PRIMITIVE_INT:  return name + "int";
+    case PRIMITIVE_BYTE: return name + "byte";
+    case PRIMITIVE_BOOL: return name + "bool";
+    }
+    return name;
+}
\ No newline at end of file
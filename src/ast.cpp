@@ -1,150 +1,80 @@
 #include "../include/AST.h"
 
-bool AST::isExpression() const {
-    return false;
-}
-
-bool AST::isFunctionDeclaration() const {
-    return false;
-}
-
-bool AST::isFunctionDefinition() const {
-    return false;
-}
-
-bool AST::isIncompleteStruct() const {
-    return false;
-}
-
-bool AST::isVariableDefinition() const {
-    return false;
-}
-
-bool AST::isWhileLoop() const {
-    return false;
-}
-
-bool AST::isReturn() const {
-    return false;
-}
-
-PrimitiveTypeAST::PrimitiveTypeAST(Primitive primitive) : primitive(primitive) {}
-
-TypeID PrimitiveTypeAST::getTypeID() const {
-    return TYPE_PRIMITIVE;
-}
+AST::AST(ASTKind kind) : kind(kind) {}
 
-PointerTypeAST::PointerTypeAST(std::unique_ptr<TypeAST> & type) : type(std::move(type)) {}
+TypeAST::TypeAST(TypeID typeID) : typeID(typeID) {}
 
-TypeID PointerTypeAST::getTypeID() const {
-    return TYPE_POINTER;
-}
+PrimitiveTypeAST::PrimitiveTypeAST(Primitive primitive) : TypeAST(TYPE_PRIMITIVE), primitive(primitive) {}
 
-StructTypeAST::StructTypeAST(Token name) : name(name) {}
+PointerTypeAST::PointerTypeAST(const TypeAST * type) : TypeAST(TYPE_POINTER), type(type) {}
 
-TypeID StructTypeAST::getTypeID() const {
-    return TYPE_STRUCT;
-}
+StructTypeAST::StructTypeAST(Token name) : TypeAST(TYPE_STRUCT), name(name) {}
 
 
 FunctionPrototypeAST::FunctionPrototypeAST(
     Token name,
-    std::vector<Parameter> & parameters, 
-    std::unique_ptr<TypeAST> & returnType
+    ArenaArray<Parameter> parameters, 
+    const TypeAST * returnType
 ) 
-: name(name), parameters(std::move(parameters)), returnType(std::move(returnType)) {}
+: name(name), parameters(parameters), returnType(returnType) {}
 
-FunctionDeclarationAST::FunctionDeclarationAST(std::unique_ptr<FunctionPrototypeAST> & prototype) 
-: prototype(std::move(prototype)) {}
-
-bool FunctionDeclarationAST::isFunctionDeclaration() const {
-    return true;
-}
+FunctionDeclarationAST::FunctionDeclarationAST(const FunctionPrototypeAST * prototype, bool isKernel) 
+: AST(AST_FUNCTION_DECLARATION), prototype(prototype), isKernel(isKernel) {}
 
 FunctionDefinitionAST::FunctionDefinitionAST(
-    std::unique_ptr<FunctionPrototypeAST> & prototype, 
-    std::unique_ptr<BodyAST> & body,
-    bool isKernel
+    const FunctionPrototypeAST * prototype, 
+    const BodyAST * body,
+    bool isKernel,
+    bool isMultiversioned
 )
-: prototype(std::move(prototype)), body(std::move(body)), isKernel(isKernel) {}
+: AST(AST_FUNCTION_DEFINITION), prototype(prototype), body(body), isKernel(isKernel),
+  isMultiversioned(isMultiversioned) {}
 
-bool FunctionDefinitionAST::isFunctionDefinition() const {
-    return true;
-}
-
-IncompleteStructAST::IncompleteStructAST(Token name) : name(name) {}
-
-bool IncompleteStructAST::isIncompleteStruct() const {
-    return true;
-}
-
-VariableAST::VariableAST(Token text) : text(text) {} 
+IncompleteStructAST::IncompleteStructAST(Token name) : AST(AST_INCOMPLETE_STRUCT), name(name) {}
 
-ExpressionID VariableAST::getExpressionID() const { 
-    return EXPRESSION_VARIABLE; 
-}
+ImportAST::ImportAST(Token name) : AST(AST_IMPORT), name(name) {}
 
-IntLiteralAST::IntLiteralAST(Token text) : text(text) {} 
+VariableAST::VariableAST(Token text) : ExpressionAST(AST_VARIABLE), text(text) {} 
 
-ExpressionID IntLiteralAST::getExpressionID() const { 
-    return EXPRESSION_INT_LITERAL; 
-}
+IntLiteralAST::IntLiteralAST(Token text, uint32_t value) 
+: ExpressionAST(AST_INT_LITERAL), text(text), value(value) {} 
 
-FloatLiteralAST::FloatLiteralAST(Token text) : text(text) {} 
+FloatLiteralAST::FloatLiteralAST(Token text, float value) 
+: ExpressionAST(AST_FLOAT_LITERAL), text(text), value(value) {} 
 
-ExpressionID FloatLiteralAST::getExpressionID() const { 
-    return EXPRESSION_FLOAT_LITERAL; 
-}
+StringLiteralAST::StringLiteralAST(Token text) : ExpressionAST(AST_STRING_LITERAL), text(text) {} 
 
-StringLiteralAST::StringLiteralAST(Token text) : text(text) {} 
+FunctionCallAST::FunctionCallAST(Token name, ArenaArray<const ExpressionAST *> arguments)
+: ExpressionAST(AST_FUNCTION_CALL), name(name), arguments(arguments) {}
 
-ExpressionID StringLiteralAST::getExpressionID() const { 
-    return EXPRESSION_STRING_LITERAL; 
-}
+NotOperationAST::NotOperationAST(const ExpressionAST * expression)
+: ExpressionAST(AST_NOT_OPERATION), expression(expression) {}
 
-FunctionCallAST::FunctionCallAST(Token name, std::vector<std::unique_ptr<ExpressionAST>> & arguments)
-: name(name), arguments(std::move(arguments)) {}
+NegationAST::NegationAST(const ExpressionAST * expression)
+: ExpressionAST(AST_NEGATION), expression(expression) {}
 
-ExpressionID FunctionCallAST::getExpressionID() const { 
-    return EXPRESSION_FUNCTION_CALL; 
+const ExpressionAST * prefixOperand(const ExpressionAST * expression) {
+    if (auto notOperation = dyn_cast<NotOperationAST>(expression)) return notOperation->expression;
+    if (auto negation = dyn_cast<NegationAST>(expression)) return negation->expression;
+    return nullptr;
 }
 
-NotOperationAST::NotOperationAST(std::unique_ptr<ExpressionAST> & expression)
-: expression(std::move(expression)) {}
-
-ExpressionID NotOperationAST::getExpressionID() const {
-    return EXPRESSION_NOT_OPERATION;
-}
+BinaryOperationAST::BinaryOperationAST(
+    BinaryOperator op, Token token, const ExpressionAST * left, const ExpressionAST * right
+) : ExpressionAST(AST_BINARY_OPERATION), op(op), token(token), left(left), right(right) {}
 
 
 VariableDefinitionAST::VariableDefinitionAST(
-    Token name, std::unique_ptr<TypeAST> & type, std::unique_ptr<ExpressionAST> & expression
-) : name(name), type(std::move(type)), expression(std::move(expression)) {}
-
-bool VariableDefinitionAST::isVariableDefinition() const {
-    return true;
-}
-
-
-bool ExpressionAST::isExpression() const {
-    return true;
-}
-
+    Token name, const TypeAST * type, const ExpressionAST * expression
+) : AST(AST_VARIABLE_DEFINITION), name(name), type(type), expression(expression) {}
 
-WhileLoopAST::WhileLoopAST(std::unique_ptr<ExpressionAST> & condition, std::unique_ptr<BodyAST> & body) 
-: condition(std::move(condition)), body(std::move(body)) {}
 
-bool WhileLoopAST::isWhileLoop() const {
-    return true;
-}
+WhileLoopAST::WhileLoopAST(const ExpressionAST * condition, const BodyAST * body) 
+: AST(AST_WHILE_LOOP), condition(condition), body(body) {}
 
 
-ReturnAST::ReturnAST(std::unique_ptr<ExpressionAST> & expression) : expression(std::move(expression)) {}
-
-bool ReturnAST::isReturn() const {
-    return true;
-}
+ReturnAST::ReturnAST(const ExpressionAST * expression) : AST(AST_RETURN), expression(expression) {}
 
 
-BodyAST::BodyAST(std::vector<std::unique_ptr<AST>> & statements) 
-: statements(std::move(statements)) {}
\ No newline at end of file
+BodyAST::BodyAST(ArenaArray<const AST *> statements) 
+: statements(statements) {}
\ No newline at end of file
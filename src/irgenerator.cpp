@@ -1,7 +1,37 @@
 #include "../include/IRGenerator.h"
 #include "llvm/IR/Constants.h"
+#include "../include/LLVMVersion.h"
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
 #include "../include/SPIRVGenerator.h"
 
+/* x86-64 microarchitecture levels (SSE4.2, AVX2, AVX-512), see calcium_cpu_level
+    in runtime/cpu.cpp. Each lists every feature it has, a function without
+    "target-features" gets the target machine's, e.g. all of -march=native's. */
+struct FeatureLevel {
+    const char * cpu;
+    const char * features;
+};
+
+static const FeatureLevel BASELINE = { "x86-64", "+64bit,+cx8,+fxsr,+mmx,+sse,+sse2,+x87" };
+
+static const FeatureLevel FEATURE_LEVELS[] = {
+    { "x86-64-v2", "+64bit,+cx8,+fxsr,+mmx,+sse,+sse2,+x87,"
+        "+cx16,+sahf,+popcnt,+crc32,+sse3,+ssse3,+sse4.1,+sse4.2" },
+    { "x86-64-v3", "+64bit,+cx8,+fxsr,+mmx,+sse,+sse2,+x87,"
+        "+cx16,+sahf,+popcnt,+crc32,+sse3,+ssse3,+sse4.1,+sse4.2,"
+        "+avx,+avx2,+bmi,+bmi2,+f16c,+fma,+lzcnt,+movbe,+xsave" },
+    { "x86-64-v4", "+64bit,+cx8,+fxsr,+mmx,+sse,+sse2,+x87,"
+        "+cx16,+sahf,+popcnt,+crc32,+sse3,+ssse3,+sse4.1,+sse4.2,"
+        "+avx,+avx2,+bmi,+bmi2,+f16c,+fma,+lzcnt,+movbe,+xsave,"
+        "+avx512f,+avx512bw,+avx512cd,+avx512dq,+avx512vl" },
+};
+
+static void setFeatureLevel(llvm::Function * function, const FeatureLevel & level) {
+    function->addFnAttr("target-cpu", level.cpu);
+    function->addFnAttr("target-features", level.features);
+}
+
 static llvm::AllocaInst * createEntryBlockAlloca(
     llvm::Function * function, llvm::Type * type, llvm::StringRef name
 ) {
@@ -11,43 +41,113 @@ static llvm::AllocaInst * createEntryBlockAlloca(
 
 IRGenerator::IRGenerator(
     Program & program,
-    std::shared_ptr<llvm::LLVMContext> & llvmContext,
-    std::shared_ptr<llvm::Module> & llvmModule
-) : program(program), llvmContext(llvmContext), llvmModule(llvmModule) {
-    irBuilder = std::make_unique<llvm::IRBuilder<>>(*llvmContext);
-
-    kernelType = llvm::StructType::create(*llvmContext, "Kernel");
+    const Interner & interner,
+    const TypeTable & types,
+    llvm::LLVMContext & llvmContext,
+    llvm::Module & llvmModule
+) : program(program), interner(interner), types(types), llvmContext(llvmContext), llvmModule(llvmModule) {
+    irBuilder = std::make_unique<llvm::IRBuilder<>>(llvmContext);
+
+    kernelType = llvm::StructType::create(llvmContext, "Kernel");
     kernelType->setBody({
         irBuilder->getInt8Ty()->getPointerTo(),
         irBuilder->getInt64Ty()
     });
+
+    // the object file targets the default triple, see Writer
+    canMultiversion = llvm::Triple(llvm::sys::getDefaultTargetTriple()).getArch() == llvm::Triple::x86_64;
+}
+
+// imported declarations have no text in this program, only symbols
+llvm::StringRef IRGenerator::getName(const Token & token) const {
+    auto name = token.symbol != Interner::NO_SYMBOL ? interner.name(token.symbol) : program.extract(token);
+    return llvm::StringRef(name.data(), name.size());
 }
 
 
 // --------------------- TOP LEVEL STATEMENTS --------------------- 
-void IRGenerator::generate(const std::vector<std::unique_ptr<AST>> & ast) {
-    for (auto & node : ast) {
-        if (node->isFunctionDeclaration()) {
-            auto declaration = static_cast<const FunctionDeclarationAST *>(node.get());
-            if (generate(declaration) == nullptr) {
-                break;
+void IRGenerator::prepare(const std::vector<const AST *> & ast) {
+    translatedTypes.resize(types.size(), nullptr);
+    globals.resize(interner.size(), nullptr);
+    functions.resize(interner.size(), nullptr);
+    prototypes.resize(interner.size(), nullptr);
+    incompleteStructs.resize(interner.size(), false);
+
+    for (auto node : ast) {
+        if (auto incompleteStruct = dyn_cast<IncompleteStructAST>(node)) {
+            incompleteStructs[incompleteStruct->name.symbol] = true;
+        } else if (auto declaration = dyn_cast<FunctionDeclarationAST>(node)) {
+            prototypes[declaration->prototype->name.symbol] = declaration->prototype;
+        } else if (auto definition = dyn_cast<FunctionDefinitionAST>(node)) {
+            prototypes[definition->prototype->name.symbol] = definition->prototype;
+        }
+    }
+}
+
+void IRGenerator::generate(const std::vector<const AST *> & ast) {
+    prepare(ast);
+
+    // everything at the top level is visible everywhere, so bodies come last
+    for (auto node : ast) {
+        switch (node->getKind()) {
+        case AST_FUNCTION_DECLARATION:
+        {
+            auto declaration = cast<FunctionDeclarationAST>(node);
+            if (declaration->isKernel) {
+                declareKernel(declaration->prototype);
+            } else if (functions[declaration->prototype->name.symbol] == nullptr) {
+                generate(declaration);
             }
-        } else if (node->isFunctionDefinition()) {
-            auto definition = static_cast<const FunctionDefinitionAST *>(node.get());
+            break;
+        }
+        case AST_FUNCTION_DEFINITION:
+        {
+            auto definition = cast<FunctionDefinitionAST>(node);
             if (definition->isKernel) {
                 generateKernel(definition);
-            } else if (generate(definition) == nullptr) {
-                break;
+            } else if (functions[definition->prototype->name.symbol] == nullptr) {
+                generate(definition->prototype);
             }
-        } else if (node->isIncompleteStruct()) {
-            auto declaration = static_cast<const IncompleteStructAST *>(node.get());
-            incompleteStructs.insert(program.extract(declaration->name));
-        } else {
+            break;
+        }
+        case AST_INCOMPLETE_STRUCT:
+            break;
+        case AST_IMPORT:
+            // already replaced by the imported declarations, see ModuleInterface::resolve
+            break;
+        default:
             assert(false);
         }
     }
 
-    llvmModule->print(llvm::errs(), nullptr);
+    for (auto node : ast) {
+        auto definition = dyn_cast<FunctionDefinitionAST>(node);
+        if (definition != nullptr && !definition->isKernel && generate(definition) == nullptr) {
+            break;
+        }
+    }
+
+    if (!multiversions.empty()) {
+        generateDispatch();
+    }
+}
+
+/* Generates a single definition, for the ObjectCache. Functions and
+    kernels it uses from the rest of the program are only declared, when
+    first used, so the module compiles to an object of its own. */
+void IRGenerator::generate(const std::vector<const AST *> & ast, const FunctionDefinitionAST * unit) {
+    prepare(ast);
+
+    if (unit->isKernel) {
+        generateKernel(unit);
+    } else {
+        generate(unit);
+    }
+
+    // every object dispatches its own multiversioned functions
+    if (!multiversions.empty()) {
+        generateDispatch();
+    }
 }
 
 // --------------------- KERNEL -----------
@@ -64,14 +164,14 @@ void IRGenerator::generateKernel(const FunctionDefinitionAST * definition) {
     auto arrayType = llvm::ArrayType::get(i32Type, code.size());
 
     auto array = new llvm::GlobalVariable(
-        *llvmModule, arrayType, true, 
-        llvm::GlobalValue::ExternalLinkage, nullptr, "code"
+        llvmModule, arrayType, true, 
+        llvm::GlobalValue::PrivateLinkage, nullptr, "code"
     );
     array->setInitializer(llvm::ConstantArray::get(arrayType, values));
 
-    auto name = program.extract(definition->prototype->name);
+    auto name = getName(definition->prototype->name);
     auto kernel = new llvm::GlobalVariable(
-        *llvmModule, kernelType, true,
+        llvmModule, kernelType, true,
         llvm::GlobalValue::ExternalLinkage, nullptr, name
     );
     kernel->setInitializer(llvm::ConstantStruct::get(kernelType, {
@@ -79,7 +179,90 @@ void IRGenerator::generateKernel(const FunctionDefinitionAST * definition) {
         llvm::ConstantInt::get(irBuilder->getInt64Ty(), code.size())
     }));
 
-    globals[name] = kernel;
+    globals[definition->prototype->name.symbol] = kernel;
+}
+
+// a kernel compiled in another module
+void IRGenerator::declareKernel(const FunctionPrototypeAST * prototype) {
+    auto kernel = new llvm::GlobalVariable(
+        llvmModule, kernelType, true,
+        llvm::GlobalValue::ExternalLinkage, nullptr, getName(prototype->name)
+    );
+    globals[prototype->name.symbol] = kernel;
+}
+
+// --------------------- MULTIVERSIONING --------------------- 
+/* Compiles the body once more for every feature level. Callers go through
+    a thunk that calls whichever version a table entry points at. The entry
+    starts at the generic version and is set to the best one the host
+    supports before main runs. The generic version and the thunk target the
+    baseline, whatever -mcpu or -march=native say. Returns the thunk. */
+llvm::Function * IRGenerator::multiversion(llvm::Function * function) {
+    std::string name = function->getName().str();
+    auto functionType = function->getFunctionType();
+
+    auto thunk = llvm::Function::Create(functionType, llvm::Function::ExternalLinkage, "", &llvmModule);
+    function->replaceAllUsesWith(thunk);
+    function->setName(name + ".default");
+    function->setLinkage(llvm::Function::InternalLinkage);
+    thunk->setName(name);
+    setFeatureLevel(function, BASELINE);
+    setFeatureLevel(thunk, BASELINE);
+
+    Multiversion multiversion;
+    multiversion.versions.push_back(function);
+    for (auto & level : FEATURE_LEVELS) {
+        llvm::ValueToValueMapTy map;
+        auto clone = llvm::CloneFunction(function, map);
+        clone->setName(name + "." + level.cpu);
+        setFeatureLevel(clone, level);
+        multiversion.versions.push_back(clone);
+    }
+
+    multiversion.table = new llvm::GlobalVariable(
+        llvmModule, function->getType(), false,
+        llvm::GlobalValue::InternalLinkage, function, name + ".version"
+    );
+
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(llvmContext, "entry", thunk));
+    std::vector<llvm::Value *> args;
+    for (auto & arg : thunk->args()) {
+        arg.setName(function->getArg(arg.getArgNo())->getName());
+        args.push_back(&arg);
+    }
+    auto version = builder.CreateLoad(function->getType(), multiversion.table, "version");
+    auto call = builder.CreateCall(functionType, version, args);
+    call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+    builder.CreateRet(call);
+
+    multiversions.push_back(std::move(multiversion));
+    return thunk;
+}
+
+// a global constructor filling every table entry from the host's feature level
+void IRGenerator::generateDispatch() {
+    auto i32Type = irBuilder->getInt32Ty();
+    auto cpuLevel = llvmModule.getOrInsertFunction("calcium_cpu_level", llvm::FunctionType::get(i32Type, false));
+
+    auto dispatch = llvm::Function::Create(
+        llvm::FunctionType::get(irBuilder->getVoidTy(), false),
+        llvm::Function::InternalLinkage, "calcium.dispatch", &llvmModule
+    );
+    setFeatureLevel(dispatch, BASELINE);
+
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(llvmContext, "entry", dispatch));
+    auto level = builder.CreateCall(cpuLevel, {}, "level");
+    for (auto & multiversion : multiversions) {
+        llvm::Value * best = multiversion.versions[0];
+        for (size_t i = 1; i < multiversion.versions.size(); i++) {
+            auto supported = builder.CreateICmpUGE(level, llvm::ConstantInt::get(i32Type, i));
+            best = builder.CreateSelect(supported, multiversion.versions[i], best);
+        }
+        builder.CreateStore(best, multiversion.table);
+    }
+    builder.CreateRetVoid();
+
+    llvm::appendToGlobalCtors(llvmModule, dispatch, 0);
 }
 
 // --------------------- PRIMITIVE TYPES --------------------- 
@@ -99,34 +282,49 @@ llvm::Type * IRGenerator::generate(Primitive primitive) {
 
 
 // --------------------- TYPES --------------------- 
-llvm::Type * IRGenerator::generate(const TypeAST * type) {
-    switch (type->getTypeID()) {
-    case TYPE_PRIMITIVE:
-    {
-        auto primitiveType = static_cast<const PrimitiveTypeAST *>(type);
-        return generate(primitiveType->primitive);
+// each type is translated once, the Analyzer only hands out types it accepted
+/* Pointers are unwrapped by a loop down to a type already translated, or
+    to their base, and wrapped again on the way back, as in Analyzer::resolve. */
+llvm::Type * IRGenerator::translate(uint32_t type) {
+    assert(type != TypeTable::NO_TYPE && type < translatedTypes.size());
+    std::vector<uint32_t> pointers;
+    while (translatedTypes[type] == nullptr && types.id(type) == TYPE_POINTER) {
+        pointers.push_back(type);
+        type = types.pointee(type);
     }
-    case TYPE_POINTER:
-    {
-        auto pointerType = static_cast<const PointerTypeAST *>(type);
-        auto gen = generate(pointerType->type.get());
-        assert(gen != nullptr);
 
-        return gen->getPointerTo();
-    }
-    case TYPE_STRUCT:
-    {
-        auto structType = static_cast<const StructTypeAST *>(type);
-        auto name = program.extract(structType->name);
-        if (incompleteStructs.find(name) != incompleteStructs.end()) {
-            // can only use incomplete structs as a pointer
-            return irBuilder->getInt8Ty();
+    llvm::Type * translated = translatedTypes[type];
+    if (translated == nullptr) {
+        switch (types.id(type)) {
+        case TYPE_PRIMITIVE:
+            translated = generate(types.primitiveOf(type));
+            break;
+        case TYPE_POINTER:
+            // unwrapped above
+            break;
+        case TYPE_STRUCT:
+        {
+            auto symbol = types.symbol(type);
+            if (incompleteStructs[symbol]) {
+                // can only use incomplete structs as a pointer
+                translated = irBuilder->getInt8Ty();
+            } else {
+                auto name = interner.name(symbol);
+                translated = llvm::StructType::getTypeByName(llvmContext, llvm::StringRef(name.data(), name.size()));
+            }
+            break;
+        }
         }
-        return llvm::StructType::getTypeByName(*llvmContext, name);
+
+        assert(translated != nullptr);
+        translatedTypes[type] = translated;
     }
-    default:
-        return nullptr;
+
+    for (auto pointer = pointers.rbegin(); pointer != pointers.rend(); ++pointer) {
+        translated = translated->getPointerTo();
+        translatedTypes[*pointer] = translated;
     }
+    return translated;
 }
 
 
@@ -134,77 +332,75 @@ llvm::Type * IRGenerator::generate(const TypeAST * type) {
 llvm::Function * IRGenerator::generate(const FunctionPrototypeAST * prototype) {
     std::vector<llvm::Type *> paramTypes;
     for (auto & param : prototype->parameters) {
-        auto paramType = generate(param.type.get());
-        assert(paramType != nullptr);
-
-        paramTypes.push_back(paramType);
+        paramTypes.push_back(translate(param.type->resolved));
     }
 
-    auto returnType = generate(prototype->returnType.get());
-    assert(returnType != nullptr);
+    auto returnType = translate(prototype->returnType->resolved);
 
     auto functionType = llvm::FunctionType::get(returnType, paramTypes, false);
-    auto name = program.extract(prototype->name);
-    auto function = llvm::Function::Create(functionType, llvm::Function::ExternalLinkage, name, llvmModule.get());
+    auto name = getName(prototype->name);
+    auto function = llvm::Function::Create(functionType, llvm::Function::ExternalLinkage, name, &llvmModule);
     
     size_t index = 0;
     for (auto & arg : function->args()) {
         auto token = prototype->parameters[index].name;
         if (token.type != TOK_NULL) {
-            arg.setName(program.extract(token));
+            arg.setName(getName(token));
         }
         index++;
     }
 
+    functions[prototype->name.symbol] = function;
     return function;
 }
 
 
 // --------------------- FUNCTION DECLARATIONS --------------------- 
 llvm::Function * IRGenerator::generate(const FunctionDeclarationAST * declaration) {
-    return generate(declaration->prototype.get());
+    return generate(declaration->prototype);
 }
 
 
 // --------------------- FUNCTION DEFINITIONS --------------------- 
 llvm::Function * IRGenerator::generate(const FunctionDefinitionAST * definition) {
-    std::string name = program.extract(definition->prototype->name);
-    llvm::Function * function = llvmModule->getFunction(name);
+    llvm::Function * function = functions[definition->prototype->name.symbol];
 
     if (function == nullptr) {
-        function = generate(definition->prototype.get());
+        function = generate(definition->prototype);
     }
 
     if (function == nullptr) {
         return nullptr;
     }
 
-    llvm::BasicBlock * basicBlock = llvm::BasicBlock::Create(*llvmContext, "entry", function);
+    llvm::BasicBlock * basicBlock = llvm::BasicBlock::Create(llvmContext, "entry", function);
     irBuilder->SetInsertPoint(basicBlock);
 
+    // parameters take the first slots, in order
+    slots.assign(definition->slotCount, nullptr);
+    auto & parameters = definition->prototype->parameters;
     for (auto & arg : function->args()) {
-        if (arg.hasName()) {
-            auto name = arg.getName();
-            auto alloc = createEntryBlockAlloca(function, arg.getType(), name);
+        auto token = parameters[arg.getArgNo()].name;
+        if (token.type != TOK_NULL) {
+            auto alloc = createEntryBlockAlloca(function, arg.getType(), getName(token));
             irBuilder->CreateStore(&arg, alloc);
-            symbols[std::string(arg.getName())].push(alloc);
+            slots[arg.getArgNo()] = alloc;
         }
     }
 
-    generate(definition->body.get());
+    generate(definition->body);
 
-    // TODO: abstract this and handle explicit return statements
-    auto returnType = definition->prototype->returnType.get();
-    if (
-        returnType->getTypeID() == TYPE_PRIMITIVE && 
-        static_cast<const PrimitiveTypeAST *>(returnType)->primitive == PRIMITIVE_UNIT
-    ) {
-        irBuilder->CreateRet(llvm::ConstantInt::get(irBuilder->getInt1Ty(), 0));
+    // falling off the end returns zero, whatever the type
+    if (irBuilder->GetInsertBlock()->getTerminator() == nullptr) {
+        irBuilder->CreateRet(llvm::Constant::getNullValue(function->getReturnType()));
     }
 
-    for (auto & arg : function->args()) {
-        if (arg.hasName()) {
-            symbols[std::string(arg.getName())].pop();
+    if (definition->isMultiversioned) {
+        if (canMultiversion) {
+            functions[definition->prototype->name.symbol] = multiversion(function);
+        } else {
+            std::cerr << "INFO: @multiversion on \"" << getName(definition->prototype->name).str() <<
+                "\" is ignored, the target is not x86-64" << std::endl;
         }
     }
 
@@ -214,112 +410,124 @@ llvm::Function * IRGenerator::generate(const FunctionDefinitionAST * definition)
 
 // --------------------- BODIES --------------------- 
 void IRGenerator::generate(const BodyAST * body) {
-    for (auto & statement : body->statements) {
-        if (statement->isExpression()) {
-            auto expression = static_cast<const ExpressionAST *>(statement.get());
-            auto value = generate(expression);
-            if (value == nullptr) {
-                return;
-            }
-        }
-        else if (statement->isVariableDefinition()) {
-            auto definition = static_cast<const VariableDefinitionAST *>(statement.get());
-            auto name = program.extract(definition->name);
+    for (auto statement : body->statements) {
+        switch (statement->getKind()) {
+        case AST_VARIABLE_DEFINITION:
+        {
+            auto definition = cast<VariableDefinitionAST>(statement);
+            auto name = getName(definition->name);
             llvm::Function * function = irBuilder->GetInsertBlock()->getParent();
-            llvm::Type * type = generate(definition->type.get());
-            llvm::Value * value = generate(definition->expression.get());
+            llvm::Type * type = translate(definition->type->resolved);
+            llvm::Value * value = generate(definition->expression);
 
             auto alloc = createEntryBlockAlloca(function, type, name);
             irBuilder->CreateStore(value, alloc);
 
-            symbols[name].push(alloc); // TODO: pop this when leaving braces scope
+            slots[definition->slot] = alloc;
+            break;
         }
-        else if (statement->isWhileLoop()) {
-            auto whileLoop = static_cast<const WhileLoopAST *>(statement.get());
+        case AST_WHILE_LOOP:
+        {
+            auto whileLoop = cast<WhileLoopAST>(statement);
             llvm::Function * function = irBuilder->GetInsertBlock()->getParent();
-            auto conditionBlock = llvm::BasicBlock::Create(*llvmContext, "while.cond", function);
-            auto bodyBlock = llvm::BasicBlock::Create(*llvmContext, "while.body", function);
-            auto endBlock = llvm::BasicBlock::Create(*llvmContext, "while.end", function);
+            auto conditionBlock = llvm::BasicBlock::Create(llvmContext, "while.cond", function);
+            auto bodyBlock = llvm::BasicBlock::Create(llvmContext, "while.body", function);
+            auto endBlock = llvm::BasicBlock::Create(llvmContext, "while.end", function);
             irBuilder->CreateBr(conditionBlock);
             // while.cond:
             irBuilder->SetInsertPoint(conditionBlock);
             // compare x <= y
-            auto value = generate(whileLoop->condition.get());
+            auto value = generate(whileLoop->condition);
             assert(value != nullptr);
             // if true, branch to while.body, otherwise while.end
             irBuilder->CreateCondBr(value, bodyBlock, endBlock);
             // while.body:
             irBuilder->SetInsertPoint(bodyBlock);
-            generate(whileLoop->body.get());
+            generate(whileLoop->body);
             // branch to while.cond
             irBuilder->CreateBr(conditionBlock);
             // while.end:
             irBuilder->SetInsertPoint(endBlock);
+            break;
+        }
+        case AST_RETURN:
+        {
+            auto value = generate(cast<ReturnAST>(statement)->expression);
+            if (value == nullptr) return;
+            irBuilder->CreateRet(value);
+            // whatever follows is dead, but still needs a block to go in
+            llvm::Function * function = irBuilder->GetInsertBlock()->getParent();
+            irBuilder->SetInsertPoint(llvm::BasicBlock::Create(llvmContext, "return.after", function));
+            break;
+        }
+        default:
+        {
+            auto value = generate(cast<ExpressionAST>(statement));
+            if (value == nullptr) {
+                return;
+            }
         }
-        else if (statement->isReturn()) {
-
         }
-
     }
 }
 
 
 // ---------------------  EXPRESSIONS --------------------- 
 llvm::Value * IRGenerator::generate(const ExpressionAST * expression) {
-    switch (expression->getExpressionID()) {
-    case EXPRESSION_INT_LITERAL:
+    switch (expression->getKind()) {
+    case AST_INT_LITERAL:
     {
-        auto intLiteral = static_cast<const IntLiteralAST *>(expression);
-        auto text = program.extract(intLiteral->text);
-        return llvm::ConstantInt::get(irBuilder->getInt32Ty(), std::stoi(text));
+        auto intLiteral = cast<IntLiteralAST>(expression);
+        return llvm::ConstantInt::get(irBuilder->getInt32Ty(), intLiteral->value);
     }
-    case EXPRESSION_STRING_LITERAL:
+    case AST_STRING_LITERAL:
     {
-        auto stringLiteral = static_cast<const StringLiteralAST *>(expression);
-        auto text = program.extract(stringLiteral->text);
-        return irBuilder->CreateGlobalStringPtr(text);
+        auto stringLiteral = cast<StringLiteralAST>(expression);
+        return irBuilder->CreateGlobalStringPtr(getName(stringLiteral->text));
     }
-    case EXPRESSION_VARIABLE:
+    case AST_VARIABLE:
     {
-        auto variable = static_cast<const VariableAST *>(expression);
-        auto name = program.extract(variable->text);
-        auto stack = symbols[name];
-        if (stack.size() == 0) {
-            assert(globals.find(name) != globals.end());
-            return globals[name];
-        } else {
-            auto alloc = symbols[name].top();
-            return irBuilder->CreateLoad(alloc->getAllocatedType(), alloc, name.c_str());
+        auto variable = cast<VariableAST>(expression);
+        if (variable->slot == VariableAST::GLOBAL) {
+            if (globals[variable->text.symbol] == nullptr) {
+                declareKernel(prototypes[variable->text.symbol]);
+            }
+            return globals[variable->text.symbol];
         }
+        auto alloc = slots[variable->slot];
+        return irBuilder->CreateLoad(alloc->getAllocatedType(), alloc, getName(variable->text));
     }
-    case EXPRESSION_NOT_OPERATION:
+    case AST_NOT_OPERATION:
+    case AST_NEGATION:
     {
-        auto notOperation = static_cast<const NotOperationAST *>(expression);
-        auto value = generate(notOperation->expression.get());
-        return irBuilder->CreateNot(value, "not");
+        // a prefix run is applied innermost first, with a loop
+        std::vector<const ExpressionAST *> run;
+        const ExpressionAST * innermost = expression;
+        while (auto operand = prefixOperand(innermost)) {
+            run.push_back(innermost);
+            innermost = operand;
+        }
+
+        auto value = generate(innermost);
+        for (auto link = run.rbegin(); link != run.rend() && value != nullptr; ++link) {
+            value = isa<NotOperationAST>(*link) ? irBuilder->CreateNot(value, "not") : irBuilder->CreateNeg(value, "neg");
+        }
+        return value;
     }
-    case EXPRESSION_FUNCTION_CALL:
+    case AST_BINARY_OPERATION:
+        return generate(cast<BinaryOperationAST>(expression));
+    case AST_FUNCTION_CALL:
     {
-        auto functionCall = static_cast<const FunctionCallAST *>(expression);
-        auto name = program.extract(functionCall->name);
-        llvm::Function * callee = llvmModule->getFunction(name);
+        auto functionCall = cast<FunctionCallAST>(expression);
+        llvm::Function * callee = functions[functionCall->name.symbol];
         if (callee == nullptr) {
-            std::cerr << "ERR: attempting to call undefined method \"" << name << "\"" << std::endl;
-            return nullptr;
-        }
-
-        size_t paramCount = callee->arg_size();
-        size_t passedArgCount = functionCall->arguments.size();
-        if (paramCount != passedArgCount) {
-            std::cerr << "ERR: expected " << paramCount << " arguments passed to \"" 
-                      << name << "\", but got " << passedArgCount << std::endl;
-            return nullptr;
+            callee = generate(prototypes[functionCall->name.symbol]);
         }
+        assert(callee->arg_size() == functionCall->arguments.size());
 
         std::vector<llvm::Value *> args;
-        for (size_t i = 0; i < paramCount; i++) {
-            
-            auto arg = generate(functionCall->arguments[i].get());
+        for (size_t i = 0; i < functionCall->arguments.size(); i++) {
+            auto arg = generate(functionCall->arguments[i]);
             if (arg == nullptr) {
                 return nullptr;
             }
@@ -332,4 +540,50 @@ llvm::Value * IRGenerator::generate(const ExpressionAST * expression) {
     default:
         return nullptr;
     }
+}
+
+// --------------------- OPERATORS --------------------- 
+/* A chain like a + b + c nests to the left as deep as it is long, so the
+    left operands are walked with a loop rather than by recursion. */
+llvm::Value * IRGenerator::generate(const BinaryOperationAST * operation) {
+    std::vector<const BinaryOperationAST *> chain;
+    const ExpressionAST * innermost = operation;
+    while (auto binary = dyn_cast<BinaryOperationAST>(innermost)) {
+        chain.push_back(binary);
+        innermost = binary->left;
+    }
+
+    auto value = generate(innermost);
+    for (auto link = chain.rbegin(); link != chain.rend() && value != nullptr; ++link) {
+        auto right = generate((*link)->right);
+        if (right == nullptr) return nullptr;
+        value = generate(*link, value, right);
+    }
+    return value;
+}
+
+// operand types were checked by the Analyzer
+llvm::Value * IRGenerator::generate(const BinaryOperationAST * operation, llvm::Value * left, llvm::Value * right) {
+    assert(left->getType() == right->getType());
+
+    // ints are signed
+    switch (operation->op) {
+    case BINARY_ADD:           return irBuilder->CreateAdd(left, right, "add");
+    case BINARY_SUBTRACT:      return irBuilder->CreateSub(left, right, "sub");
+    case BINARY_MULTIPLY:      return irBuilder->CreateMul(left, right, "mul");
+    case BINARY_DIVIDE:        return irBuilder->CreateSDiv(left, right, "div");
+    case BINARY_REMAINDER:     return irBuilder->CreateSRem(left, right, "rem");
+    case BINARY_AND:           return irBuilder->CreateAnd(left, right, "and");
+    case BINARY_OR:            return irBuilder->CreateOr(left, right, "or");
+    case BINARY_XOR:           return irBuilder->CreateXor(left, right, "xor");
+    case BINARY_SHIFT_LEFT:    return irBuilder->CreateShl(left, right, "shl");
+    case BINARY_SHIFT_RIGHT:   return irBuilder->CreateAShr(left, right, "shr");
+    case BINARY_EQUAL:         return irBuilder->CreateICmpEQ(left, right, "eq");
+    case BINARY_NOT_EQUAL:     return irBuilder->CreateICmpNE(left, right, "ne");
+    case BINARY_LESS:          return irBuilder->CreateICmpSLT(left, right, "lt");
+    case BINARY_LESS_EQUAL:    return irBuilder->CreateICmpSLE(left, right, "le");
+    case BINARY_GREATER:       return irBuilder->CreateICmpSGT(left, right, "gt");
+    case BINARY_GREATER_EQUAL: return irBuilder->CreateICmpSGE(left, right, "ge");
+    }
+    return nullptr;
 }
\ No newline at end of file
@@ -1,258 +1,476 @@
 #include "../include/Lexer.h"
+#include "../include/Program.h"
+#include "../include/Scanner.h"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstring>
+#include <thread>
+
+enum CharClass : uint8_t {
+    CHAR_INVALID,
+    CHAR_WHITESPACE,
+    CHAR_NEWLINE,
+    CHAR_ALPHA,
+    CHAR_DIGIT,
+    CHAR_DOT,
+    CHAR_QUOTE,
+    CHAR_SLASH,
+    CHAR_PUNCTUATION
+};
+
+static constexpr char PUNCTUATION[] = "*:(){},;@=!-+%&|^<>";
+
+static constexpr std::array<uint8_t, 256> makeCharClasses() {
+    std::array<uint8_t, 256> classes {};
+    for (int c = 'a'; c <= 'z'; c++) classes[c] = CHAR_ALPHA;
+    for (int c = 'A'; c <= 'Z'; c++) classes[c] = CHAR_ALPHA;
+    for (int c = '0'; c <= '9'; c++) classes[c] = CHAR_DIGIT;
+    for (size_t i = 0; i < sizeof(PUNCTUATION) - 1; i++) {
+        classes[static_cast<unsigned char>(PUNCTUATION[i])] = CHAR_PUNCTUATION;
+    }
+    classes[' '] = CHAR_WHITESPACE;
+    classes['\t'] = CHAR_WHITESPACE;
+    classes['\r'] = CHAR_WHITESPACE;
+    classes['\v'] = CHAR_WHITESPACE;
+    classes['\f'] = CHAR_WHITESPACE;
+    classes['\n'] = CHAR_NEWLINE;
+    classes['.'] = CHAR_DOT;
+    classes['"'] = CHAR_QUOTE;
+    classes['/'] = CHAR_SLASH;
+    return classes;
+}
+
+static constexpr std::array<TokenType, 256> makePunctuationTokens() {
+    std::array<TokenType, 256> tokens {};
+    tokens['*'] = TOK_STAR;
+    tokens[':'] = TOK_COLON;
+    tokens['('] = TOK_OPEN_PAREN;
+    tokens[')'] = TOK_CLOSE_PAREN;
+    tokens['{'] = TOK_OPEN_BRACE;
+    tokens['}'] = TOK_CLOSE_BRACE;
+    tokens[','] = TOK_COMMA;
+    tokens[';'] = TOK_SEMICOLON;
+    tokens['@'] = TOK_AT;
+    tokens['='] = TOK_EQUALS;
+    tokens['!'] = TOK_NOT;
+    tokens['-'] = TOK_MINUS;
+    tokens['+'] = TOK_PLUS;
+    tokens['%'] = TOK_PERCENT;
+    tokens['&'] = TOK_AMPERSAND;
+    tokens['|'] = TOK_PIPE;
+    tokens['^'] = TOK_CARET;
+    tokens['<'] = TOK_LESS;
+    tokens['>'] = TOK_GREATER;
+    return tokens;
+}
+
+static constexpr auto charClasses = makeCharClasses();
+static constexpr auto punctuationTokens = makePunctuationTokens();
+
+static inline uint8_t charClass(char c) {
+    return charClasses[static_cast<unsigned char>(c)];
+}
+
+struct Keyword {
+    const char * text;
+    size_t length;
+    TokenType type;
+};
+
+// Perfect hash over the keyword set: (4 * first + 5 * last + length) mod 16.
+// Adding a keyword requires picking new coefficients without collisions.
+static const Keyword keywords[16] = {
+    { nullptr,  0, TOK_NULL },
+    { "fun",    3, TOK_FUN },
+    { nullptr,  0, TOK_NULL },
+    { nullptr,  0, TOK_NULL },
+    { "return", 6, TOK_RETURN },
+    { "byte",   4, TOK_BYTE },
+    { "struct", 6, TOK_STRUCT },
+    { "let",    3, TOK_LET },
+    { "bool",   4, TOK_BOOL },
+    { "ker",    3, TOK_KER },
+    { "while",  5, TOK_WHILE },
+    { "int",    3, TOK_INT },
+    { "unit",   4, TOK_UNIT },
+    { nullptr,  0, TOK_NULL },
+    { "import", 6, TOK_IMPORT },
+    { nullptr,  0, TOK_NULL },
+};
+
+static TokenType lookupKeyword(const char * text, size_t length) {
+    assert(length > 0);
+    auto first = static_cast<unsigned char>(text[0]);
+    auto last = static_cast<unsigned char>(text[length - 1]);
+    const Keyword & keyword = keywords[(4 * first + 5 * last + length) & 15];
+
+    if (keyword.length == length && std::memcmp(keyword.text, text, length) == 0) {
+        return keyword.type;
+    }
+    return TOK_IDENTIFIER;
+}
 
-static std::string takeExample(const std::string & text, size_t index) {
-    size_t exampleLength = std::min(20ull, text.size() - index);
+static std::string_view takeExample(std::string_view text, size_t index) {
+    size_t exampleLength = std::min<size_t>(20, text.size() - index);
     auto example = text.substr(index, exampleLength);
     auto newLineIndex = example.find("\n");
-    if (newLineIndex != std::string::npos) {
+    if (newLineIndex != std::string_view::npos) {
         example = example.substr(0, newLineIndex);
     }
     return example;
 }
 
-Token::Token() : type(TOK_NULL) {}
+Token::Token() : type(TOK_NULL), offset(0), length(0), symbol(Interner::NO_SYMBOL) {}
 
-Lexer::Lexer(const std::string & program) : program(program) {
-    index = 0;
-    line = 1;
-    column = 1;
-}
+Token::Token(TokenType type, uint32_t offset, uint32_t length, uint32_t symbol)
+: type(type), offset(offset), length(length), symbol(symbol) {}
 
-bool Lexer::eof() const {
-    return index >= program.size();
+size_t TokenBuffer::size() const {
+    return types.size();
 }
 
-char Lexer::get() const {
-    assert(!eof());
-    return program[index];
+Token TokenBuffer::operator[](size_t index) const {
+    return Token(type(index), offsets[index], lengths[index], symbols[index]);
 }
 
-void Lexer::advance() {
-    index++;
-    column++;
+TokenType TokenBuffer::type(size_t index) const {
+    return static_cast<TokenType>(types[index]);
 }
 
-void Lexer::skipWhitespace() {
-    char c;
-    while(!eof() && iswspace(c = get())) {
-        advance();
+void TokenBuffer::push(TokenType type, uint32_t offset, uint32_t length, uint32_t symbol) {
+    static_assert(TOK_EOF <= UINT8_MAX, "token types must fit in a byte");
+    types.push_back(static_cast<uint8_t>(type));
+    offsets.push_back(offset);
+    lengths.push_back(length);
+    symbols.push_back(symbol);
+}
 
-        if (c == '\n') {
-            line++;
-            column = 1;
-        }
-    }
+void TokenBuffer::reserve(size_t capacity) {
+    types.reserve(capacity);
+    offsets.reserve(capacity);
+    lengths.reserve(capacity);
+    symbols.reserve(capacity);
+}
 
-    skipComment();
+void TokenBuffer::resize(size_t count) {
+    types.resize(count);
+    offsets.resize(count);
+    lengths.resize(count);
+    symbols.resize(count);
 }
 
-void Lexer::skipComment() {
-    if (index < program.size() - 2 && get() == '/' && program[index + 1] == '/') {
-        while (!eof() && get() != '\n') advance();
-        index++;
-        line++;
-        column = 1;
+void TokenBuffer::write(size_t begin, const TokenBuffer & source) {
+    assert(begin + source.size() <= size());
+    std::copy(source.types.begin(), source.types.end(), types.begin() + begin);
+    std::copy(source.offsets.begin(), source.offsets.end(), offsets.begin() + begin);
+    std::copy(source.lengths.begin(), source.lengths.end(), lengths.begin() + begin);
+    std::copy(source.symbols.begin(), source.symbols.end(), symbols.begin() + begin);
+}
 
-        skipWhitespace();
+void TokenBuffer::renumber(const std::vector<uint32_t> & mapping) {
+    for (auto & symbol : symbols) {
+        symbol = mapping[symbol];
     }
 }
 
-bool Lexer::readIdentifier(Token * const token) {
-    assert(token != nullptr);
+void TokenBuffer::replace(size_t begin, size_t end, const TokenBuffer & replacement) {
+    assert(begin <= end && end <= size());
+    types.erase(types.begin() + begin, types.begin() + end);
+    offsets.erase(offsets.begin() + begin, offsets.begin() + end);
+    lengths.erase(lengths.begin() + begin, lengths.begin() + end);
+    symbols.erase(symbols.begin() + begin, symbols.begin() + end);
+
+    types.insert(types.begin() + begin, replacement.types.begin(), replacement.types.end());
+    offsets.insert(offsets.begin() + begin, replacement.offsets.begin(), replacement.offsets.end());
+    lengths.insert(lengths.begin() + begin, replacement.lengths.begin(), replacement.lengths.end());
+    symbols.insert(symbols.begin() + begin, replacement.symbols.begin(), replacement.symbols.end());
+}
 
-    if (eof()) return false;
-    if (!isalpha(get())) return false;
+void TokenBuffer::shift(size_t begin, int64_t delta) {
+    auto difference = static_cast<uint32_t>(delta); // wraps around for negative deltas
+    for (size_t i = begin; i < offsets.size(); i++) {
+        offsets[i] += difference;
+    }
+}
 
-    token->type = TOK_IDENTIFIER;
-    token->startIndex = index;
-    token->line = line;
-    token->column = column;
+Lexer::Lexer(const Program & program, Interner & interner, std::ostream & diagnostics)
+: program(program), interner(interner), diagnostics(diagnostics), text(program.source()) {
+    assert(text.size() <= UINT32_MAX);
+    index = 0;
+    errorOffset = 0;
+}
 
-    advance();
-    while (!eof() && isalnum(get())) advance();
+void Lexer::seek(size_t index) {
+    assert(index <= text.size());
+    this->index = index;
+}
 
-    token->endIndex = index;
-    return true;
+size_t Lexer::getErrorOffset() const {
+    return errorOffset;
 }
 
-bool Lexer::readFloatLiteral(Token * const token) {
-    assert(token != nullptr);
+bool Lexer::eof() const {
+    return index >= text.size();
+}
 
-    if (eof()) return false;
+// Reading at the end of the text yields the '\0' sentinel.
+char Lexer::get() const {
+    assert(index <= text.size());
+    return text.data()[index];
+}
 
-    size_t startIndex = index;
+void Lexer::skipWhitespace() {
+    const char * data = text.data();
+    const char * limit = data + text.size();
 
-    char c;
-    while (!eof() && isdigit(c = get())) {
-        advance();
-    }
+    while (true) {
+        const char * p = scanWhitespace(data + index, limit);
 
-    if (c != '.') {
-        rewind(startIndex);
-        return false;
-    }
+        if (limit - p < 2 || p[0] != '/' || p[1] != '/') {
+            index = p - data;
+            return;
+        }
 
-    advance();
-    while (!eof() && isdigit(c = get())) {
-        advance();
+        // the trailing newline is consumed as whitespace on the next iteration
+        index = scanNewline(p + 2, limit) - data;
     }
+}
 
-    // check if no digits
-    if (index == startIndex + 1) {
-        rewind(startIndex);
-        return false;
-    }
+TokenType Lexer::readIdentifier() {
+    assert(charClass(get()) == CHAR_ALPHA);
+
+    size_t startIndex = index;
+    const char * data = text.data();
+    index = scanAlphanumeric(data + index + 1, data + text.size()) - data;
 
-    token->type = TOK_FLOAT_LITERAL;
-    token->startIndex = startIndex;
-    token->line = line;
-    token->column = column;
-    token->endIndex = index;
-    
-    return true;
+    return lookupKeyword(data + startIndex, index - startIndex);
 }
 
-bool Lexer::readIntLiteral(Token * const token) {
-    assert(token != nullptr);
+TokenType Lexer::readNumberLiteral() {
+    size_t startIndex = index;
 
-    if (eof()) return false;
-    if (!isdigit(get())) return false;
+    while (charClass(get()) == CHAR_DIGIT) index++;
 
-    token->startIndex = index;
+    if (get() != '.') {
+        return TOK_INT_LITERAL;
+    }
+
+    index++; // '.'
+    while (charClass(get()) == CHAR_DIGIT) index++;
 
-    char c;
-    while (!eof() && isdigit(c = get())) {
-        advance();
+    // a lone "." is not a number
+    if (index == startIndex + 1) {
+        index = startIndex;
+        return TOK_NULL;
     }
 
-    token->type = TOK_INT_LITERAL;
-    token->line = line;
-    token->column = column;
-    token->endIndex = index;
-    
-    return true;
+    return TOK_FLOAT_LITERAL;
 }
 
-bool Lexer::readStringLiteral(Token * const token) {
-    assert(token != nullptr);
-
-    if (eof()) return false;
-    if (get() != '"') return false;
+TokenType Lexer::readStringLiteral() {
+    assert(get() == '"');
 
     size_t startIndex = index;
-    advance();
+    const char * data = text.data();
+    index = scanQuoteOrNewline(data + index + 1, data + text.size()) - data;
 
-    if (eof()) {
-        rewind(startIndex);
-        return false;
+    // strings may not span multiple lines
+    if (get() != '"') {
+        index = startIndex;
+        return TOK_NULL;
     }
 
-    char c;
-    while ((c = get()) != '"') {
-        if (c == '\n') {
-            rewind(startIndex);
-            return false;
-        }
-        advance();
+    index++; // '"'
+    return TOK_STRING_LITERAL;
+}
 
-        if (eof()) {
-            rewind(startIndex);
-            return false;
-        }
+TokenType Lexer::readPunctuation() {
+    TokenType type = punctuationTokens[static_cast<unsigned char>(get())];
+    if (type == TOK_NULL) return type;
+    index++;
+
+    // two-character operators begin with a one-character one
+    TokenType longer = TOK_NULL;
+    char next = get();
+    switch (type) {
+    case TOK_EQUALS:
+        if (next == '=') longer = TOK_EQUALS_EQUALS;
+        break;
+    case TOK_NOT:
+        if (next == '=') longer = TOK_NOT_EQUALS;
+        break;
+    case TOK_LESS:
+        if (next == '=') longer = TOK_LESS_EQUALS;
+        if (next == '<') longer = TOK_SHIFT_LEFT;
+        break;
+    case TOK_GREATER:
+        if (next == '=') longer = TOK_GREATER_EQUALS;
+        if (next == '>') longer = TOK_SHIFT_RIGHT;
+        break;
+    default:
+        break;
     }
-    
-    advance(); // '"'
 
-    token->type = TOK_STRING_LITERAL;
-    token->startIndex = startIndex;
-    token->endIndex = index;
-    token->line = line;
-    token->column = column;
+    if (longer == TOK_NULL) return type;
+    index++;
+    return longer;
+}
+
+Error Lexer::tokenize(TokenBuffer & tokens) {
+    Token token;
+    auto err = next(&token);
+
+    while (err == ERR_NONE && token.type != TOK_EOF) {
+        tokens.push(token.type, token.offset, token.length, token.symbol);
+        err = next(&token);
+    }
 
-    return true;
+    return err;
 }
 
-bool Lexer::readExact(Token * const token, TokenType type, const std::string & str) {
-    assert(token != nullptr);
-    
-    size_t startIndex = index;
+/* Every token, and every comment, ends before the next newline. So a chunk
+    starting right after a newline begins outside of any token and can be lexed
+    by itself, without knowing anything about the chunks before it. */
+Error Lexer::tokenize(TokenBuffer & tokens, unsigned jobs) {
+    size_t remaining = text.size() - index;
+    size_t chunkCount = std::min<size_t>(jobs, remaining / MIN_CHUNK_SIZE);
+    if (chunkCount <= 1) {
+        return tokenize(tokens);
+    }
 
-    for (char c : str) {
-        if (eof() || c != get()) {
-            rewind(startIndex);
-            return false;
-        }
+    std::vector<size_t> bounds { index };
+    for (size_t i = 1; i < chunkCount; i++) {
+        size_t split = std::max(index + remaining / chunkCount * i, bounds.back());
+        size_t newline = text.find('\n', split);
+        if (newline == std::string_view::npos) break;
+        if (newline + 1 < text.size()) bounds.push_back(newline + 1);
+    }
+    bounds.push_back(text.size());
+    chunkCount = bounds.size() - 1;
+
+    std::vector<TokenBuffer> chunks(chunkCount);
+    std::vector<Interner> interners(chunkCount);
+    std::vector<Error> errors(chunkCount);
+    std::vector<size_t> stops(chunkCount);
+
+    // the first chunk is lexed on this thread and can use the shared interner
+    auto lexChunk = [&](size_t i) {
+        Lexer lexer(program, i == 0 ? interner : interners[i]);
+        lexer.seek(bounds[i]);
+        chunks[i].reserve((bounds[i + 1] - bounds[i]) / 4);
+        errors[i] = lexer.tokenizeUntil(bounds[i + 1], chunks[i]);
+        stops[i] = lexer.index;
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < chunkCount; i++) {
+        threads.emplace_back(lexChunk, i);
+    }
+    lexChunk(0);
+    for (auto & thread : threads) thread.join();
+    threads.clear();
+
+    // only the chunks up to the first error make it into the serial result
+    size_t used = 0;
+    while (used < chunkCount && errors[used] == ERR_NONE) used++;
+    size_t usedCount = std::min(used + 1, chunkCount);
+
+    std::vector<size_t> starts(usedCount + 1, tokens.size());
+    for (size_t i = 0; i < usedCount; i++) {
+        starts[i + 1] = starts[i] + chunks[i].size();
+    }
 
-        advance();
+    // merging in chunk order numbers symbols by first occurrence, as serially
+    std::vector<std::vector<uint32_t>> mappings(usedCount);
+    for (size_t i = 1; i < usedCount; i++) {
+        mappings[i] = interner.merge(interners[i]);
     }
 
-    token->type = type;
-    token->startIndex = startIndex;
-    token->line = line;
-    token->column = column;
-    token->endIndex = index;
+    tokens.resize(starts[usedCount]);
+    for (size_t i = 1; i < usedCount; i++) {
+        threads.emplace_back([&, i] {
+            chunks[i].renumber(mappings[i]);
+            tokens.write(starts[i], chunks[i]);
+        });
+    }
+    tokens.write(starts[0], chunks[0]);
+    for (auto & thread : threads) thread.join();
 
-    return true;
+    if (used < chunkCount) {
+        // lex the bad token again here, where it can be reported in order
+        seek(stops[used]);
+        Token token;
+        return next(&token);
+    }
+
+    index = text.size();
+    return ERR_NONE;
 }
 
-void Lexer::rewind(size_t oldIndex) {
-    assert(oldIndex <= index);
+/* Lexes tokens starting before limit, stopping quietly at an invalid token. */
+Error Lexer::tokenizeUntil(size_t limit, TokenBuffer & tokens) {
+    while (true) {
+        skipWhitespace();
+        if (index >= limit) return ERR_NONE;
 
-    // TODO: doesn't support "tokens" across multiple lines
-    size_t difference = index - oldIndex;
-    column -= difference;
+        size_t startIndex = index;
+        TokenType type = readToken();
+        if (type == TOK_NULL) {
+            index = startIndex;
+            return ERR_INVALID_TOKEN;
+        }
 
-    index = oldIndex;
+        tokens.push(type, startIndex, index - startIndex, intern(type, startIndex));
+    }
 }
 
-Error Lexer::tokenize(std::vector<Token> & tokens) {
-    skipWhitespace();
+TokenType Lexer::readToken() {
+    switch (charClass(get())) {
+    case CHAR_ALPHA:
+        return readIdentifier();
+    case CHAR_DIGIT:
+    case CHAR_DOT:
+        return readNumberLiteral();
+    case CHAR_QUOTE:
+        return readStringLiteral();
+    case CHAR_PUNCTUATION:
+        return readPunctuation();
+    case CHAR_SLASH:
+        // comments were skipped as whitespace, so this is a division
+        index++;
+        return TOK_SLASH;
+    default:
+        return TOK_NULL;
+    }
+}
 
-    while (!eof()) {
-        Token token;
+Error Lexer::next(Token * token) {
+    assert(token != nullptr);
 
-        bool success = 
-            readExact(&token, TOK_FUN, "fun") || 
-            readExact(&token, TOK_KER, "ker") || 
-            // readExact(&token, KERNEL, "Kernel") || 
-            readExact(&token, TOK_STRUCT, "struct") || 
-            readExact(&token, TOK_UNIT, "unit") || 
-            readExact(&token, TOK_INT, "int") || 
-            readExact(&token, TOK_BYTE, "byte") || 
-            readExact(&token, TOK_BOOL, "bool") || 
-            // readExact(&token, VEC2, "vec2") || 
-            // readExact(&token, VEC4, "vec4") || 
-            readExact(&token, TOK_LET, "let") || 
-            readExact(&token, TOK_WHILE, "while") || 
-            readExact(&token, TOK_RETURN, "return") || 
-            readExact(&token, TOK_STAR, "*") || 
-            readExact(&token, TOK_OPEN_PAREN, "(") || 
-            readExact(&token, TOK_CLOSE_PAREN, ")") || 
-            readExact(&token, TOK_OPEN_BRACE, "{") || 
-            readExact(&token, TOK_CLOSE_BRACE, "}") || 
-            readExact(&token, TOK_COMMA, ",") || 
-            readExact(&token, TOK_COLON, ":") || 
-            readExact(&token, TOK_SEMICOLON, ";") || 
-            readExact(&token, TOK_EQUALS, "=") || 
-            readExact(&token, TOK_NOT, "!") || 
-            readExact(&token, TOK_MINUS, "-") || 
-            readIdentifier(&token) || 
-            readFloatLiteral(&token) ||
-            readIntLiteral(&token) ||
-            readStringLiteral(&token);
-
-        if (!success) {
-            auto example = takeExample(program, index);
-            std::cerr << "ERR: invalid token at line " << line << 
-                ", column " << column << ": \"" << example << "\"" << std::endl;
-            return ERR_INVALID_TOKEN;
-        }
+    skipWhitespace();
 
-        tokens.push_back(token);
+    size_t startIndex = index;
+    if (eof()) {
+        *token = Token(TOK_EOF, startIndex, 0);
+        return ERR_NONE;
+    }
 
-        skipWhitespace();
+    TokenType type = readToken();
+    if (type == TOK_NULL) {
+        errorOffset = startIndex;
+        auto example = takeExample(text, index);
+        auto location = program.locate(index);
+        diagnostics << "ERR: invalid token at line " << location.line <<
+            ", column " << location.column << ": \"" << example << "\"" << std::endl;
+        return ERR_INVALID_TOKEN;
     }
 
+    *token = Token(type, startIndex, index - startIndex, intern(type, startIndex));
     return ERR_NONE;
 }
+
+uint32_t Lexer::intern(TokenType type, size_t startIndex) {
+    if (type != TOK_IDENTIFIER) return Interner::NO_SYMBOL;
+    return interner.intern(text.substr(startIndex, index - startIndex));
+}
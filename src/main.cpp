@@ -1,14 +1,24 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <thread>
 
+#include "../include/SourceBuffer.h"
 #include "../include/Parser.h"
+#include "../include/ModuleInterface.h"
+#include "../include/Analyzer.h"
 #include "../include/IRGenerator.h"
 #include "../include/Writer.h"
+#include "../include/JIT.h"
+#include "../include/Interpreter.h"
+#include "../include/ObjectCache.h"
+#include "../include/Linker.h"
+#include "../include/LanguageServer.h"
 
-#include <vulkan/vulkan.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
 
 /*
 compile/link in one go: https://discourse.llvm.org/t/compile-to-native/62196/3
@@ -26,70 +36,258 @@ For an API to generate and assembling SPIR-V code.
 
 */
 
+// -O0 to -O3 and -Os, as in clang
+static bool parseOptimization(const std::string & argument, Optimization * optimization) {
+    assert(optimization != nullptr);
+    if (argument.size() != 3 || argument[0] != '-' || argument[1] != 'O') {
+        return false;
+    }
+
+    switch (argument[2]) {
+    case '0': *optimization = OPTIMIZE_NONE; return true;
+    case '1': *optimization = OPTIMIZE_LESS; return true;
+    case '2': *optimization = OPTIMIZE_DEFAULT; return true;
+    case '3': *optimization = OPTIMIZE_AGGRESSIVE; return true;
+    case 's': *optimization = OPTIMIZE_SIZE; return true;
+    default:  return false;
+    }
+}
+
 int main(int argc, char* argv[]) {
+    if (argc == 2 && std::string(argv[1]) == "--lsp") {
+        LanguageServer server;
+        return server.run();
+    }
+
+    unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+    unsigned partitions = 1; // objects written, only split when -j is given
+    bool emitInterface = false;
+    OutputOptions output;
+    bool targetHost = false;
+    std::string cpu;
+    bool run = false;
+    bool interpret = true;
+    bool tierUp = true;
+    std::vector<std::string> libraries;
+    std::string cacheDirectory;
+    std::string executable; // -o, linked in process instead of writing objects
+
 #ifdef _DEBUG
     std::string filename = "../../examples/shader.ca";
 #else
-    if (argc != 2) {
-        std::cerr << "ERR: expected 1 argument, e,g. calcium main.ca" << std::endl;
+    std::string filename;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "-j" && i + 1 < argc) {
+            jobs = std::max(1, std::atoi(argv[++i]));
+            partitions = jobs;
+        } else if (argument == "-o" && i + 1 < argc) {
+            executable = argv[++i];
+        } else if (argument == "-ffunction-sections") {
+            output.functionSections = true;
+        } else if (argument == "--emit-interface") {
+            emitInterface = true;
+        } else if (parseOptimization(argument, &output.optimization)) {
+            continue;
+        } else if (argument == "--emit-llvm") {
+            output.emitLLVM = true;
+        } else if (argument == "--time-passes") {
+            output.timePasses = true;
+        } else if (argument.rfind("-mcpu=", 0) == 0) {
+            cpu = argument.substr(6);
+        } else if (argument.rfind("-mattr=", 0) == 0) {
+            output.features = argument.substr(7);
+        } else if (argument == "-march=native") {
+            targetHost = true;
+        } else if (argument == "--run") {
+            run = true;
+        } else if (argument == "--jit") {
+            interpret = false;
+        } else if (argument == "--interpret") {
+            tierUp = false;
+        } else if (argument == "--runtime" && i + 1 < argc) {
+            libraries.push_back(argv[++i]);
+        } else if (argument == "--cache" && i + 1 < argc) {
+            cacheDirectory = argv[++i];
+        } else if (filename.empty()) {
+            filename = argument;
+        } else {
+            filename.clear();
+            break;
+        }
+    }
+
+    if (filename.empty()) {
+        std::cerr << "ERR: expected 1 source file, e,g. calcium [-o app] [-j 8] [-O2] [-march=native] [--time-passes] [--emit-llvm] [--emit-interface] [--cache dir] [--run [--jit | --interpret] [--runtime lib.so]] main.ca (or calcium --lsp)" << std::endl;
         return 1;
     }
-    std::string filename = argv[1];
-#endif
 
-    std::ifstream stream(filename);
-    if (!stream) {
-        std::cerr << "ERR: could not find file " << filename << std::endl;
+    // an explicit -mcpu wins over the host's
+    if (targetHost) output.targetHost();
+    if (!cpu.empty()) output.cpu = cpu;
+    if (output.emitLLVM && (!executable.empty() || !cacheDirectory.empty())) {
+        std::cerr << "ERR: --emit-llvm writes name.ll, it can't be combined with -o or --cache" << std::endl;
         return 1;
     }
 
-    std::stringstream buffer;
-    buffer << stream.rdbuf();
+    if (!tierUp && !Interpreter::SUPPORTED) {
+        std::cerr << "ERR: --interpret is not supported on this target, --run compiles everything with the JIT" << std::endl;
+        return 1;
+    }
 
-    std::string text = buffer.str();
-    Program program(text);
-    
-    // ============ LEXER ============
-    
-    Lexer lexer(text);
-    
-    std::vector<Token> tokens;
-    auto err = lexer.tokenize(tokens);
+    // before any work, which would be thrown away
+    if (!run && !executable.empty() && !Linker::available()) {
+        return ERR_LINK;
+    }
+
+    // so --gc-sections can drop whatever isn't called
+    if (!executable.empty()) output.functionSections = true;
+#endif
+
+    SourceBuffer source;
+    auto err = source.open(filename);
     if (err != ERR_NONE) return err;
 
-    // ============ PARSER ============
+    Program program(source.text());
+    
+    // ============ LEXER + PARSER ============
     
-    Parser parser(program, tokens);
+    Interner interner;
+    Lexer lexer(program, interner);
+    Arena arena;
+    std::vector<const AST *> ast;
 
-    std::vector<std::unique_ptr<AST>> ast;
-    err = parser.parse(ast);
+    // large programs are lexed and parsed on several threads, others stream
+    if (jobs > 1 && program.source().size() >= 2 * Lexer::MIN_CHUNK_SIZE) {
+        TokenBuffer buffer;
+        err = lexer.tokenize(buffer, jobs);
+        if (err != ERR_NONE) return err;
+        err = Parser::parse(program, buffer, jobs, arena, ast);
+    } else {
+        TokenStream tokens(lexer);
+        Parser parser(program, tokens, arena);
+        err = parser.parse(ast);
+    }
 
     if (err != ERR_NONE) {
         return err;
     }
 
+    // ============ MODULES ============
+
+    std::string basename = filename.substr(0, filename.find_last_of("."));
+
+    // written before imports are resolved, only this module's declarations are exported
+    if (emitInterface) {
+        err = ModuleInterface::write(basename + ".cai", interner, ast);
+        if (err != ERR_NONE) return err;
+    }
+
+    std::string directory = filename.substr(0, filename.find_last_of("/\\") + 1);
+    err = ModuleInterface::resolve(directory, interner, arena, ast);
+    if (err != ERR_NONE) return err;
+
     // ============ SEMANTIC ANALYSIS ============
 
+    TypeTable types;
+    Analyzer analyzer(program, interner, types);
+    err = analyzer.analyze(ast, jobs);
+    if (err != ERR_NONE) return err;
+
+    // ============ RUN IN PROCESS ============
+
+    // starts in the interpreter, hot functions are compiled in the background
+    if (run && interpret && Interpreter::SUPPORTED) {
+        Interpreter interpreter(program, interner, types, output, libraries, tierUp);
+        int exitCode;
+        err = interpreter.run(ast, &exitCode);
+        if (err != ERR_NONE) return err;
+        return exitCode;
+    }
+
+    // ============ OBJECT CACHE ============
+
+    // one object per definition, only the ones that changed are compiled
+    if (!run && !cacheDirectory.empty()) {
+        ObjectCache cache(program, interner, types, output, cacheDirectory);
+        std::vector<std::string> objects;
+        size_t compiled;
+        err = cache.build(ast, jobs, &objects, &compiled);
+        if (err != ERR_NONE) return err;
+        std::cout << "INFO: compiled " << compiled << " of " << objects.size() << " definitions" << std::endl;
+
+        std::string outputFilename = executable;
+        if (executable.empty()) {
+            outputFilename = basename + ".rsp";
+            err = ObjectCache::writeResponseFile(outputFilename, objects);
+        } else {
+            Linker linker(libraries);
+            err = linker.link(objects, executable);
+        }
+        if (err != ERR_NONE) return err;
+
+        std::cout << "INFO: wrote to \"" << outputFilename << "\"" << std::endl;
+        return 0;
+    }
+
     // ============ CODE GENERATION ============
 
-    auto llvmContext = std::make_shared<llvm::LLVMContext>();
-    auto llvmModule = std::make_shared<llvm::Module>("Calcium", *llvmContext);
+    auto llvmContext = std::make_unique<llvm::LLVMContext>();
+    auto llvmModule = std::make_unique<llvm::Module>("Calcium", *llvmContext);
 
-    IRGenerator irGenerator(program, llvmContext, llvmModule);
+    IRGenerator irGenerator(program, interner, types, *llvmContext, *llvmModule);
     irGenerator.generate(ast);
 
+    // everything is compiled before main starts
+    if (run) {
+        JIT jit(output, libraries);
+        int exitCode;
+        err = jit.run(std::move(llvmContext), std::move(llvmModule), &exitCode);
+        if (err != ERR_NONE) return err;
+        return exitCode;
+    }
+
     // ============ OUTPUT TO OBJECT FILE ============
 
-    std::string outputFilename = filename.substr(0, filename.find_last_of(".")) + ".o";
+    // name.o, or name.0.o, name.1.o, ... with -j, and .ll with --emit-llvm
+    // objects linked with -o are temporary and removed once main returns
+    std::vector<std::string> outputFilenames;
+    std::vector<std::unique_ptr<llvm::FileRemover>> temporaries;
+    for (unsigned i = 0; i < partitions; i++) {
+        if (executable.empty()) {
+            std::string extension = output.emitLLVM ? ".ll" : ".o";
+            outputFilenames.push_back(partitions == 1 ? basename + extension : basename + "." + std::to_string(i) + extension);
+            continue;
+        }
 
-    Writer writer(llvmModule);
-    err = writer.output(outputFilename);
+        llvm::SmallString<128> temporary;
+        if (auto created = llvm::sys::fs::createTemporaryFile("calcium", "o", temporary)) {
+            std::cerr << "ERR: could not create a temporary object, " << created.message() << std::endl;
+            return ERR_OUTPUT_OBJECT_FILE;
+        }
+        temporaries.push_back(std::make_unique<llvm::FileRemover>(temporary));
+        outputFilenames.push_back(std::string(temporary));
+    }
+
+    Writer writer(*llvmModule, output);
+    err = writer.output(outputFilenames);
 
     if (err != ERR_NONE) {
         return err;
     }
 
-    std::cout << "INFO: wrote to \"" << outputFilename << "\"" << std::endl;
+    if (!executable.empty()) {
+        Linker linker(libraries);
+        err = linker.link(outputFilenames, executable);
+        if (err != ERR_NONE) return err;
+
+        std::cout << "INFO: wrote to \"" << executable << "\"" << std::endl;
+        return 0;
+    }
+
+    for (auto & outputFilename : outputFilenames) {
+        std::cout << "INFO: wrote to \"" << outputFilename << "\"" << std::endl;
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -1,56 +1,201 @@
 #include "../include/Parser.h"
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
 
 bool ParserError::empty() {
     return message.tellp() == std::streampos(0);
 }
 
-Parser::Parser(const Program & program, const std::vector<Token> & tokens) 
-: program(program), tokens(tokens) {
+Parser::Parser(const Program & program, TokenStream & tokens, Arena & arena, std::ostream & diagnostics) 
+: program(program), tokens(tokens), arena(arena), diagnostics(diagnostics), folder(arena) {
     index = 0;
+    depth = 0;
+    errorOffset = 0;
 }
 
-Error Parser::parse(std::vector<std::unique_ptr<AST>> & ast) {
+bool Parser::enter() {
+    depth++;
+    if (depth <= MAX_NESTING_DEPTH) return true;
+
+    if (!eof() && error.empty()) {
+        error.token = get();
+        error.message << "nesting deeper than " << MAX_NESTING_DEPTH << " levels";
+    }
+    return false;
+}
+
+void Parser::leave() {
+    assert(depth > 0);
+    depth--;
+}
+
+Error Parser::parse(std::vector<const AST *> & ast) {
     while (!eof()) {
-        std::unique_ptr<AST> statement;
-        bool success = parseFunction(&statement) || parseStruct(&statement);
+        const AST * statement;
+        bool success;
+        switch (get().type) {
+        case TOK_FUN:
+        case TOK_KER:
+        case TOK_AT:
+            success = parseFunction(&statement);
+            break;
+        case TOK_STRUCT:
+            success = parseStruct(&statement);
+            break;
+        case TOK_IMPORT:
+            success = parseImport(&statement);
+            break;
+        default:
+            success = false;
+        }
 
         if (!success) {
+            if (tokens.error() != ERR_NONE) {
+                return tokens.error();
+            }
+
+            // past the last token, the stream yields an end of file token
+            errorOffset = error.empty() ? tokens.get(index).offset : error.token.offset;
             if (error.empty()) {
                 if (eof()) {
-                    std::cerr << "ERR: unexpected end of file " << std::endl;
+                    errorMessage = "unexpected end of file";
+                    diagnostics << "ERR: unexpected end of file " << std::endl;
                 } else {
-                    auto token = get();
-                    std::cerr << "ERR: line " << token.line << ", column " << token.column << std::endl;
+                    errorMessage = "unexpected \"" + std::string(program.extract(get())) + "\"";
+                    auto location = program.locate(get());
+                    diagnostics << "ERR: line " << location.line << ", column " << location.column << std::endl;
                 }
             } else {
-                std::cerr << "ERR: " << error.message.str() << std::endl;
-                std::cerr << "ERR: line " << error.token.line << ", column " << error.token.column << std::endl;
+                errorMessage = error.message.str();
+                diagnostics << "ERR: " << errorMessage << std::endl;
+                auto location = program.locate(error.token);
+                diagnostics << "ERR: line " << location.line << ", column " << location.column << std::endl;
             }
             return ERR_INVALID_TOP_LEVEL_STATEMENT;
         }
 
-        ast.push_back(std::move(statement));
+        ast.push_back(statement);
+    }
+
+    return tokens.error();
+}
+
+size_t Parser::getErrorOffset() const {
+    return errorOffset;
+}
+
+const std::string & Parser::getErrorMessage() const {
+    return errorMessage;
+}
+
+static bool isDeclarationStart(TokenType type) {
+    return type == TOK_FUN || type == TOK_KER || type == TOK_AT || type == TOK_STRUCT || type == TOK_IMPORT;
+}
+
+/* Declarations never nest, and each one ends with a semicolon or a closing
+    brace. So a declaration keyword at brace depth zero right after one of
+    those starts a new declaration, and the chunks split there parse exactly
+    as they would as part of the whole program. */
+Error Parser::parse(
+    const Program & program, const TokenBuffer & tokens, unsigned jobs,
+    Arena & arena, std::vector<const AST *> & ast, std::ostream & diagnostics
+) {
+    size_t size = tokens.size();
+    size_t chunkCount = std::min<size_t>(jobs, size / MIN_CHUNK_TOKENS);
+    if (chunkCount <= 1) {
+        TokenStream stream(tokens, 0, size);
+        Parser parser(program, stream, arena, diagnostics);
+        return parser.parse(ast);
+    }
+
+    std::vector<size_t> bounds { 0 };
+    size_t depth = 0;
+    for (size_t i = 1; i < size && bounds.size() < chunkCount; i++) {
+        auto previous = tokens.type(i - 1);
+        if (previous == TOK_OPEN_BRACE) {
+            depth++;
+        } else if (previous == TOK_CLOSE_BRACE && depth > 0) {
+            depth--;
+        }
+
+        bool isStart = depth == 0 && isDeclarationStart(tokens.type(i)) &&
+            (previous == TOK_SEMICOLON || previous == TOK_CLOSE_BRACE);
+        if (isStart && i >= size / chunkCount * bounds.size()) {
+            bounds.push_back(i);
+        }
+    }
+    bounds.push_back(size);
+    chunkCount = bounds.size() - 1;
+
+    std::vector<std::unique_ptr<Arena>> arenas(chunkCount);
+    std::vector<std::vector<const AST *>> trees(chunkCount);
+    std::vector<std::stringstream> messages(chunkCount);
+    std::vector<Error> errors(chunkCount);
+
+    // the first chunk is parsed on this thread, straight into the caller's arena
+    auto parseChunk = [&](size_t i) {
+        if (i > 0) arenas[i] = std::make_unique<Arena>();
+        TokenStream stream(tokens, bounds[i], bounds[i + 1]);
+        Parser parser(program, stream, i == 0 ? arena : *arenas[i], messages[i]);
+        errors[i] = parser.parse(i == 0 ? ast : trees[i]);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < chunkCount; i++) {
+        threads.emplace_back(parseChunk, i);
+    }
+    parseChunk(0);
+    for (auto & thread : threads) thread.join();
+
+    // only the chunks up to the first error make it into the serial result
+    for (size_t i = 0; i < chunkCount; i++) {
+        diagnostics << messages[i].str();
+        if (i > 0) {
+            ast.insert(ast.end(), trees[i].begin(), trees[i].end());
+            arena.adopt(*arenas[i]);
+        }
+
+        if (errors[i] != ERR_NONE) {
+            return errors[i];
+        }
     }
 
     return ERR_NONE;
 }
 
-bool Parser::parseFunction(std::unique_ptr<AST> * statement) {
-    bool isKernel = false;
-    auto prototype = parseFunctionPrototype(isKernel);
+bool Parser::parseFunction(const AST ** statement) {
+    if (eof()) return false;
 
-    if (prototype == nullptr) {
-        isKernel = true;
-        prototype = parseFunctionPrototype(isKernel);
+    bool isMultiversioned = false;
+    if (get().type == TOK_AT && !parseAttribute(&isMultiversioned)) {
+        return false;
     }
 
+    if (eof()) {
+        diagnostics << "ERR: incomplete function prototype" << std::endl;
+        return false;
+    }
+
+    bool isKernel = get().type == TOK_KER;
+    if (isKernel && isMultiversioned) {
+        error.token = get();
+        error.message << "kernels cannot be multiversioned";
+        return false;
+    }
+
+    auto prototype = parseFunctionPrototype(isKernel);
+
     if (prototype == nullptr) {
         return false;
     }
 
     if (eof()) {
-        std::cerr << "ERR: incomplete function prototype" << std::endl;
+        diagnostics << "ERR: incomplete function prototype" << std::endl;
         return false;
     }
 
@@ -63,42 +208,89 @@ bool Parser::parseFunction(std::unique_ptr<AST> * statement) {
             return false;
         }
 
+        if (isMultiversioned) {
+            error.token = get();
+            error.message << "only function definitions can be multiversioned";
+            return false;
+        }
+
         index++;
         
-        *statement = std::make_unique<FunctionDeclarationAST>(prototype);
+        *statement = arena.make<FunctionDeclarationAST>(prototype);
     } else {
         auto body = parseBody();
         if (body == nullptr) {
-            std::cerr << "ERR: function \"" << program.extract(prototype->name) << 
+            diagnostics << "ERR: function \"" << program.extract(prototype->name) << 
                 "\" has invalid body" << std::endl;
             return false;
         }
 
-        *statement = std::make_unique<FunctionDefinitionAST>(prototype, body, isKernel);
+        *statement = arena.make<FunctionDefinitionAST>(prototype, body, isKernel, isMultiversioned);
     }
 
     return true;
 }
 
-bool Parser::parseStruct(std::unique_ptr<AST> * statement) {
+// @multiversion is the only attribute so far
+bool Parser::parseAttribute(bool * isMultiversioned) {
+    assert(isMultiversioned != nullptr);
+
+    Token name;
+    if (!(expect(TOK_AT) && expectIdentifier(&name))) {
+        if (!eof() && error.empty()) {
+            error.token = get();
+            error.message << "expected an attribute name after \"@\", found: \"" <<
+                program.extract(error.token) << "\"";
+        }
+        return false;
+    }
+
+    if (program.extract(name) != "multiversion") {
+        error.token = name;
+        error.message << "unknown attribute \"" << program.extract(name) << "\"";
+        return false;
+    }
+
+    *isMultiversioned = true;
+    return true;
+}
+
+bool Parser::parseStruct(const AST ** statement) {
     Token name;
     if (!(expect(TOK_STRUCT) && expectIdentifier(&name) && expect(TOK_SEMICOLON))) {
         return false;
     }
 
-    *statement = std::make_unique<IncompleteStructAST>(name);
+    *statement = arena.make<IncompleteStructAST>(name);
     return true;
 }
 
-std::unique_ptr<BodyAST> Parser::parseBody() {
-    size_t startIndex = index;
+bool Parser::parseImport(const AST ** statement) {
+    Token name;
+    if (!(expect(TOK_IMPORT) && expectIdentifier(&name) && expect(TOK_SEMICOLON))) {
+        if (!eof() && error.empty()) {
+            error.token = get();
+            error.message << "expected a module name and \";\" after \"import\", found: \"" <<
+                program.extract(error.token) << "\"";
+        }
+        return false;
+    }
+
+    *statement = arena.make<ImportAST>(name);
+    return true;
+}
 
+BodyAST * Parser::parseBody() {
     if (!expect(TOK_OPEN_BRACE)) {
-        index = startIndex;
         return nullptr;
     }
 
-    auto statements = parseStatementList();
+    ArenaArray<const AST *> statements;
+    bool success = enter() && parseStatementList(&statements);
+    leave();
+    if (!success) {
+        return nullptr;
+    }
 
     if (!expect(TOK_CLOSE_BRACE)) {
         if (!eof() && error.empty()) {
@@ -106,328 +298,497 @@ std::unique_ptr<BodyAST> Parser::parseBody() {
             error.message << "missing closing brace, found: \"" <<
                 program.extract(error.token) << "\"";
         }
-        index = startIndex;
         return nullptr;
     }
 
-    return std::make_unique<BodyAST>(statements);
+    return arena.make<BodyAST>(statements);
 }
 
-std::vector<std::unique_ptr<AST>> Parser::parseStatementList() {
-    std::vector<std::unique_ptr<AST>> statements;
+bool Parser::parseStatementList(ArenaArray<const AST *> * statements) {
+    assert(statements != nullptr);
+
+    // nested bodies push above this one on the shared scratch stack
+    size_t begin = statementScratch.size();
+    while (!eof() && isStatementStart(get().type)) {
+        auto statement = parseStatement();
+        if (statement == nullptr) {
+            statementScratch.resize(begin);
+            return false;
+        }
 
-    auto statement = parseStatement();
-    while (statement != nullptr) {
-        statements.push_back(std::move(statement));
-        statement = parseStatement();
+        statementScratch.push_back(statement);
     }
 
-    return statements;
+    *statements = arena.take(statementScratch, begin);
+    return true;
 }
 
-std::unique_ptr<AST> Parser::parseStatement() {
-    size_t startIndex = index;
-
-    bool requireSemicolon = true;
+bool Parser::isStatementStart(TokenType type) {
+    return type == TOK_LET || type == TOK_RETURN || type == TOK_WHILE || isExpressionStart(type);
+}
 
-    std::unique_ptr<AST> statement = parseExpression();
-    if (statement == nullptr) {
+const AST * Parser::parseStatement() {
+    const AST * statement;
+    switch (get().type) {
+    case TOK_LET:
         statement = parseVariableDefinition();
-    }
-
-    if (statement == nullptr) {
+        break;
+    case TOK_RETURN:
         statement = parseReturn();
-    }
-
-    if (statement == nullptr) {
-        statement = parseWhileLoop();
-        requireSemicolon = false;
+        break;
+    case TOK_WHILE:
+        // the body closes the loop, no semicolon
+        return parseWhileLoop();
+    default:
+        statement = parseExpression();
     }
 
     if (statement == nullptr) {
         return nullptr;
     }
 
-    if (requireSemicolon && !expect(TOK_SEMICOLON)) {
+    if (!expect(TOK_SEMICOLON)) {
         if (index > 0 && !eof() && error.empty()) {
-            error.token = tokens[index - 1];
+            error.token = tokens.get(index - 1);
             error.message << "missing semicolon, found: \"" << program.extract(get()) << "\"";
         }
-
-        index = startIndex;
         return nullptr;
     }
 
     return statement;
 }
 
-std::unique_ptr<VariableDefinitionAST> Parser::parseVariableDefinition() {
-    size_t startIndex = index;
+VariableDefinitionAST * Parser::parseVariableDefinition() {
     Token name;
-    std::unique_ptr<TypeAST> type;
-    std::unique_ptr<ExpressionAST> expression;
-    bool hasLet = expect(TOK_LET);
-    bool success = hasLet && 
+    const TypeAST * type;
+    const ExpressionAST * expression;
+    bool success = expect(TOK_LET) && 
         expectIdentifier(&name) && expect(TOK_COLON) && 
         expectType(&type) && expect(TOK_EQUALS) && 
         expectExpression(&expression);
 
     if (!success) {
-        if (!eof() && hasLet) {
-            auto token = get();
-            std::cerr << "ERR: unexpected symbol in variable definition: \"" << 
-                program.extract(token) << "\"" << std::endl;
+        if (!eof() && error.empty()) {
+            error.token = get();
+            error.message << "unexpected symbol in variable definition: \"" << 
+                program.extract(error.token) << "\"";
         }
-
-        index = startIndex;
         return nullptr;
     }
 
-    return std::make_unique<VariableDefinitionAST>(name, type, expression);
+    return arena.make<VariableDefinitionAST>(name, type, expression);
 }
 
-std::unique_ptr<ReturnAST> Parser::parseReturn() {
-    size_t startIndex = index;
-    std::unique_ptr<ExpressionAST> expression;
-    bool hasReturn = expect(TOK_RETURN);
-    bool success = hasReturn && expectExpression(&expression);
+ReturnAST * Parser::parseReturn() {
+    const ExpressionAST * expression;
+    bool success = expect(TOK_RETURN) && expectExpression(&expression);
     if (!success) {
-        if (!eof() && hasReturn && error.empty()) {
+        if (!eof() && error.empty()) {
             error.token = get();
             error.message << "missing expression in return statement, found \""
                 << program.extract(error.token) << "\"";
         }
-
-        index = startIndex;
         return nullptr;
     }
 
-    return std::make_unique<ReturnAST>(expression);
+    return arena.make<ReturnAST>(expression);
 }
 
-std::unique_ptr<WhileLoopAST> Parser::parseWhileLoop() {
-    size_t startIndex = index;
-    std::unique_ptr<ExpressionAST> condition;
-    bool hasWhile = expect(TOK_WHILE);
-    bool success = hasWhile &&
+WhileLoopAST * Parser::parseWhileLoop() {
+    const ExpressionAST * condition;
+    bool success = expect(TOK_WHILE) &&
         expect(TOK_OPEN_PAREN) && expectExpression(&condition) && expect(TOK_CLOSE_PAREN);
 
     if (!success) {
-        if (!eof() && hasWhile) {
-            auto token = get();
-            std::cerr << "ERR: unexpected symbol in while loop: \"" << 
-                program.extract(token) << "\"" << std::endl;
+        if (!eof() && error.empty()) {
+            error.token = get();
+            error.message << "unexpected symbol in while loop: \"" << 
+                program.extract(error.token) << "\"";
         }
-
-        index = startIndex;
         return nullptr;
     }
 
+    // an error inside the body has already been reported where it happened
     auto body = parseBody();
     if (body == nullptr) {
-        if (!eof()) {
-            auto token = get();
-            std::cerr << "ERR: missing while loop body, found: \"" << 
-                program.extract(token) << "\"" << std::endl;
+        if (!eof() && error.empty()) {
+            error.token = get();
+            error.message << "missing while loop body, found: \"" << 
+                program.extract(error.token) << "\"";
         }
-
-        index = startIndex;
         return nullptr;
     }
 
-    return std::make_unique<WhileLoopAST>(condition, body);
+    return arena.make<WhileLoopAST>(condition, body);
+}
+
+bool Parser::isExpressionStart(TokenType type) {
+    switch (type) {
+    case TOK_NOT:
+    case TOK_MINUS:
+    case TOK_OPEN_PAREN:
+    case TOK_INT_LITERAL:
+    case TOK_FLOAT_LITERAL:
+    case TOK_STRING_LITERAL:
+    case TOK_IDENTIFIER:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const ExpressionAST * Parser::parseExpression() {
+    return parseBinaryOperation(0);
+}
+
+/* Precedence climbing: takes the operators that bind tighter than
+    precedence and leaves the rest to the caller, so a chain of operators is
+    parsed in one loop per precedence level. Every operator is left
+    associative. */
+const ExpressionAST * Parser::parseBinaryOperation(int precedence) {
+    auto left = parseUnaryExpression();
+    if (left == nullptr) return nullptr;
+
+    while (!eof()) {
+        auto token = get();
+        BinaryOperator op;
+        int next = binaryPrecedence(token.type, &op);
+        if (next <= precedence) break;
+        index++;
+
+        auto right = parseBinaryOperation(next);
+        if (right == nullptr) {
+            if (!eof() && error.empty()) {
+                error.token = get();
+                error.message << "expected an expression after \"" << program.extract(token) << 
+                    "\", found: \"" << program.extract(error.token) << "\"";
+            }
+            return nullptr;
+        }
+
+        const ExpressionAST * folded = folder.foldBinary(op, token, left, right);
+        left = folded != nullptr ? folded : arena.make<BinaryOperationAST>(op, token, left, right);
+    }
+
+    return left;
 }
 
-std::unique_ptr<ExpressionAST> Parser::parseExpression() {
-    std::unique_ptr<ExpressionAST> expr;
+int Parser::binaryPrecedence(TokenType type, BinaryOperator * op) {
+    assert(op != nullptr);
+    switch (type) {
+    case TOK_EQUALS_EQUALS:  *op = BINARY_EQUAL;         return 1;
+    case TOK_NOT_EQUALS:     *op = BINARY_NOT_EQUAL;     return 1;
+    case TOK_LESS:           *op = BINARY_LESS;          return 1;
+    case TOK_LESS_EQUALS:    *op = BINARY_LESS_EQUAL;    return 1;
+    case TOK_GREATER:        *op = BINARY_GREATER;       return 1;
+    case TOK_GREATER_EQUALS: *op = BINARY_GREATER_EQUAL; return 1;
+    // bitwise operators bind tighter than comparisons, so a & b == 0 needs no parentheses
+    case TOK_PIPE:           *op = BINARY_OR;            return 2;
+    case TOK_CARET:          *op = BINARY_XOR;           return 3;
+    case TOK_AMPERSAND:      *op = BINARY_AND;           return 4;
+    case TOK_SHIFT_LEFT:     *op = BINARY_SHIFT_LEFT;    return 5;
+    case TOK_SHIFT_RIGHT:    *op = BINARY_SHIFT_RIGHT;   return 5;
+    case TOK_PLUS:           *op = BINARY_ADD;           return 6;
+    case TOK_MINUS:          *op = BINARY_SUBTRACT;      return 6;
+    case TOK_STAR:           *op = BINARY_MULTIPLY;      return 7;
+    case TOK_SLASH:          *op = BINARY_DIVIDE;        return 7;
+    case TOK_PERCENT:        *op = BINARY_REMAINDER;     return 7;
+    default:
+        return 0;
+    }
+}
+
+/* Prefix operators are collected by a loop and applied innermost first, so a
+    long run of them costs no stack here. Later passes walk the run with a
+    loop too, so it does not count towards the nesting depth. */
+const ExpressionAST * Parser::parseUnaryExpression() {
+    size_t begin = prefixScratch.size();
+    while (!eof() && (get().type == TOK_NOT || get().type == TOK_MINUS)) {
+        prefixScratch.push_back(get());
+        index++;
+    }
+
+    if (prefixScratch.size() == begin) {
+        return parsePrimaryExpression();
+    }
 
-    expr = parseNotOperation();
-    if (expr) return expr;
+    // a literal right after "-" may be one larger, for -2147483648
+    bool isNegated = prefixScratch.back().type == TOK_MINUS;
+    const ExpressionAST * expression = isNegated && !eof() && get().type == TOK_INT_LITERAL ?
+        parseIntLiteral(true) : parsePrimaryExpression();
 
-    expr = parseToken<IntLiteralAST, TOK_INT_LITERAL>();
-    if (expr) return expr;
-    
-    expr = parseToken<FloatLiteralAST, TOK_FLOAT_LITERAL>();
-    if (expr) return expr;
-    
-    expr = parseToken<StringLiteralAST, TOK_STRING_LITERAL>();
-    if (expr) return expr;
+    if (expression == nullptr) {
+        if (!eof() && error.empty()) {
+            error.token = get();
+            error.message << "expected an expression after \"" << program.extract(prefixScratch.back()) << 
+                "\", found: \"" << program.extract(error.token) << "\"";
+        }
+        prefixScratch.resize(begin);
+        return nullptr;
+    }
 
-    expr = parseFunctionCall();
-    if (expr) return expr;
+    for (size_t i = prefixScratch.size(); i-- > begin; ) {
+        auto token = prefixScratch[i];
+        const ExpressionAST * folded;
+        if (token.type == TOK_NOT) {
+            folded = folder.foldNot(token, expression);
+            expression = folded != nullptr ? folded : arena.make<NotOperationAST>(expression);
+        } else {
+            folded = folder.foldNegation(token, expression);
+            expression = folded != nullptr ? folded : arena.make<NegationAST>(expression);
+        }
+    }
+
+    prefixScratch.resize(begin);
+    return expression;
+}
+
+const ExpressionAST * Parser::parsePrimaryExpression() {
+    if (eof()) return nullptr;
 
-    return parseToken<VariableAST, TOK_IDENTIFIER>();
+    switch (get().type) {
+    case TOK_OPEN_PAREN:
+        return parseParenthesized();
+    case TOK_INT_LITERAL:
+        return parseIntLiteral();
+    case TOK_FLOAT_LITERAL:
+        return parseFloatLiteral();
+    case TOK_STRING_LITERAL:
+        return parseToken<StringLiteralAST, TOK_STRING_LITERAL>();
+    case TOK_IDENTIFIER:
+        // second token of lookahead tells a call from a variable
+        if (tokens.type(index + 1) == TOK_OPEN_PAREN) {
+            return parseFunctionCall();
+        }
+        return parseToken<VariableAST, TOK_IDENTIFIER>();
+    default:
+        return nullptr;
+    }
 }
 
-std::unique_ptr<NotOperationAST> Parser::parseNotOperation() {
-    size_t startIndex = index;
+const ExpressionAST * Parser::parseParenthesized() {
+    const ExpressionAST * expression;
+    if (!expect(TOK_OPEN_PAREN)) {
+        return nullptr;
+    }
 
-    std::unique_ptr<ExpressionAST> expression;
-    if (!(expect(TOK_NOT) && expectExpression(&expression))) {
-        index = startIndex;
+    bool success = enter() && expectExpression(&expression);
+    leave();
+    if (!success) {
+        return nullptr;
+    }
+
+    if (!expect(TOK_CLOSE_PAREN)) {
+        if (!eof() && error.empty()) {
+            error.token = get();
+            error.message << "missing closing parenthesis, found: \"" << 
+                program.extract(error.token) << "\"";
+        }
         return nullptr;
     }
 
-    return std::make_unique<NotOperationAST>(expression);
+    return expression;
 }
 
-std::unique_ptr<FunctionCallAST> Parser::parseFunctionCall() {
-    // TODO: calling expressions, function pointers
+/* Ints are signed, so literals go up to INT32_MAX. The smallest int has no
+    positive counterpart and is only in range written as -2147483648. */
+IntLiteralAST * Parser::parseIntLiteral(bool isNegated) {
+    uint64_t limit = isNegated ? uint64_t(INT32_MAX) + 1 : INT32_MAX;
+    auto token = get();
+    uint64_t value = 0;
+    for (char digit : program.extract(token)) {
+        value = value * 10 + (digit - '0');
+        if (value > limit) {
+            if (error.empty()) {
+                error.token = token;
+                error.message << "integer literal out of range: \"" << program.extract(token) << "\"";
+            }
+            return nullptr;
+        }
+    }
 
-    size_t startIndex = index;
+    index++;
+    return arena.make<IntLiteralAST>(token, static_cast<uint32_t>(value));
+}
+
+FloatLiteralAST * Parser::parseFloatLiteral() {
+    auto token = get();
+    index++;
+    // the text is not followed by a terminator of its own
+    float value = std::strtof(std::string(program.extract(token)).c_str(), nullptr);
+    return arena.make<FloatLiteralAST>(token, value);
+}
+
+FunctionCallAST * Parser::parseFunctionCall() {
+    // TODO: calling expressions, function pointers
 
     Token name;
     if (!(expectIdentifier(&name) && expect(TOK_OPEN_PAREN))) {
-        index = startIndex;
         return nullptr;
     }
 
-    auto expressions = parseExpressionList();
+    ArenaArray<const ExpressionAST *> expressions;
+    bool success = enter() && parseExpressionList(&expressions);
+    leave();
+    if (!success) {
+        return nullptr;
+    }
 
     if (!expect(TOK_CLOSE_PAREN)) {
-        index = startIndex;
+        if (!eof() && error.empty()) {
+            error.token = get();
+            error.message << "unexpected symbol in arguments to \"" << program.extract(name) << 
+                "\": \"" << program.extract(error.token) << "\"";
+        }
         return nullptr;
     }
 
-    return std::make_unique<FunctionCallAST>(name, expressions);
+    return arena.make<FunctionCallAST>(name, expressions);
 }
 
-std::vector<std::unique_ptr<ExpressionAST>> Parser::parseExpressionList() {
-    std::vector<std::unique_ptr<ExpressionAST>> expressions;
+bool Parser::parseExpressionList(ArenaArray<const ExpressionAST *> * expressions) {
+    assert(expressions != nullptr);
 
-    auto expression = parseExpression();
-    while (expression != nullptr) {
-        expressions.push_back(std::move(expression));
+    if (eof() || !isExpressionStart(get().type)) {
+        return true;
+    }
 
-        size_t lastIndex = index;
-        if (!expect(TOK_COMMA)) {
-            index = lastIndex;
-            break;
+    size_t begin = expressionScratch.size();
+    do {
+        const ExpressionAST * expression;
+        if (!expectExpression(&expression)) {
+            if (!eof() && error.empty()) {
+                error.token = get();
+                error.message << "expected an expression, found: \"" << 
+                    program.extract(error.token) << "\"";
+            }
+            expressionScratch.resize(begin);
+            return false;
         }
 
-        expression = parseExpression();
-        // TODO: ALLOWS TRAILING COMMA!
-    }
+        expressionScratch.push_back(expression);
+    } while (expect(TOK_COMMA));
 
-    return expressions;
+    *expressions = arena.take(expressionScratch, begin);
+    return true;
 }
 
-std::unique_ptr<FunctionPrototypeAST> Parser::parseFunctionPrototype(bool isKernel) {
-    size_t startIndex = index;
-
+FunctionPrototypeAST * Parser::parseFunctionPrototype(bool isKernel) {
     Token name;
-    std::unique_ptr<TypeAST> returnType;
+    const TypeAST * returnType;
 
     auto keyword = isKernel ? TOK_KER : TOK_FUN;
-    if (!(expect(keyword) && expectIdentifier(&name) && expect(TOK_OPEN_PAREN))) {
-        index = startIndex;
-        return nullptr;
-    }
+    ArenaArray<Parameter> parameterList;
+    bool success = expect(keyword) && expectIdentifier(&name) && expect(TOK_OPEN_PAREN) &&
+        parseParameterList(&parameterList) &&
+        expect(TOK_CLOSE_PAREN) && expect(TOK_COLON) && expectType(&returnType);
 
-    auto parameterList = parseParameterList();
-
-    if (!(expect(TOK_CLOSE_PAREN) && expect(TOK_COLON) && expectType(&returnType))) {
+    if (!success) {
         if (!eof() && error.empty()) {
             error.token = get();
             error.message << "unexpected symbol in function prototype: \"" << 
                 program.extract(error.token) << "\"";
         }
-
-        index = startIndex;
         return nullptr;
     }
 
-    return std::make_unique<FunctionPrototypeAST>(name, parameterList, returnType);
+    return arena.make<FunctionPrototypeAST>(name, parameterList, returnType);
 }
 
-std::unique_ptr<TypeAST> Parser::parseType() {
+/* Stars are counted by a loop and the pointers wrapped around the base
+    once it is read, as in Analyzer::resolve, so a long run of them costs
+    no stack here. Each one still counts as a level of nesting, LLVM prints
+    pointer types recursively, e.g. for --emit-llvm. */
+TypeAST * Parser::parseType() {
+    size_t pointers = 0;
+    while (!eof() && get().type == TOK_STAR) {
+        pointers++;
+        index++;
+    }
     if (eof()) return nullptr;
 
+    if (pointers > MAX_NESTING_DEPTH) {
+        if (error.empty()) {
+            error.token = get();
+            error.message << "pointer type nested deeper than " << MAX_NESTING_DEPTH << " levels";
+        }
+        return nullptr;
+    }
+
+    TypeAST * type = nullptr;
     auto tok = get();
     switch (tok.type) {
     case TOK_IDENTIFIER:
-        index++;
-        return std::make_unique<StructTypeAST>(tok);
+        type = arena.make<StructTypeAST>(tok);
+        break;
     case TOK_UNIT:
-        index++;
-        return std::make_unique<PrimitiveTypeAST>(PRIMITIVE_UNIT);
+        type = arena.make<PrimitiveTypeAST>(PRIMITIVE_UNIT);
+        break;
     case TOK_BYTE: 
-        index++;
-        return std::make_unique<PrimitiveTypeAST>(PRIMITIVE_BYTE);
+        type = arena.make<PrimitiveTypeAST>(PRIMITIVE_BYTE);
+        break;
     case TOK_INT: 
-        index++;
-        return std::make_unique<PrimitiveTypeAST>(PRIMITIVE_INT);
+        type = arena.make<PrimitiveTypeAST>(PRIMITIVE_INT);
+        break;
     case TOK_BOOL: 
-        index++;
-        return std::make_unique<PrimitiveTypeAST>(PRIMITIVE_BOOL);
-    case TOK_STAR:
-    {
-        index++;
-        auto type = parseType();
-        if (type) {
-            return std::make_unique<PointerTypeAST>(type);
-        } else {
-            if (!eof()) {
-                auto token = get();
-                std::cerr << "ERR: unexpected symbol in pointer type: \"" << 
-                    program.extract(token) << "\"" << std::endl;
-            }
-            index--;
-        }
-    }
+        type = arena.make<PrimitiveTypeAST>(PRIMITIVE_BOOL);
+        break;
     default:
+        if (pointers > 0) {
+            diagnostics << "ERR: unexpected symbol in pointer type: \"" << 
+                program.extract(tok) << "\"" << std::endl;
+        }
         return nullptr;
     }
+
+    index++;
+    for (size_t i = 0; i < pointers; i++) {
+        type = arena.make<PointerTypeAST>(type);
+    }
+    return type;
 }
 
-bool Parser::parseParameter(Token * name, std::unique_ptr<TypeAST> * type) {
+bool Parser::parseParameter(Token * name, const TypeAST ** type) {
     assert(name != nullptr);
     assert(type != nullptr);
-    size_t startIndex = index;
 
-    if (expectIdentifier(name) && expect(TOK_COLON) && expectType(type)) {
-        return true;
+    // "name: type", or an unnamed "type", which may itself be an identifier
+    if (get().type == TOK_IDENTIFIER && tokens.type(index + 1) == TOK_COLON) {
+        *name = get();
+        index += 2;
+    } else {
+        *name = Token();
     }
 
-    index = startIndex;
-    if (expectType(type)) return true;
-
-    index = startIndex;
-    return false;
+    return expectType(type);
 }
 
-std::vector<Parameter> Parser::parseParameterList() {
-    std::vector<Parameter> parameters;
+bool Parser::parseParameterList(ArenaArray<Parameter> * parameters) {
+    assert(parameters != nullptr);
 
-    Token name;
-    std::unique_ptr<TypeAST> type;
-    bool hasParameter = parseParameter(&name, &type);
-    if (!hasParameter) {
-        if (!eof() && error.empty()) {
-            auto token = get();
-            if (token.type != TOK_CLOSE_PAREN) {
-                error.token = token;
-                error.message << "ERR: unexpected symbol in parameter list: \"" << 
-                    program.extract(token) << "\"";
-            }
-        }
-        return parameters;
+    if (eof() || get().type == TOK_CLOSE_PAREN) {
+        return true;
     }
 
-    while (hasParameter) {
-        parameters.push_back({ name, std::move(type) });
-
-        size_t lastIndex = index;
-        if (!expect(TOK_COMMA)) {
-            index = lastIndex;
-            break;
+    size_t begin = parameterScratch.size();
+    do {
+        Token name;
+        const TypeAST * type;
+        if (eof() || !parseParameter(&name, &type)) {
+            if (!eof() && error.empty()) {
+                error.token = get();
+                error.message << "unexpected symbol in parameter list: \"" << 
+                    program.extract(error.token) << "\"";
+            }
+            parameterScratch.resize(begin);
+            return false;
         }
 
-        hasParameter = parseParameter(&name, &type);
-        // TODO: ALLOWS TRAILING COMMA!
-    }
+        parameterScratch.push_back({ name, type });
+    } while (expect(TOK_COMMA));
 
-    return parameters;
+    *parameters = arena.take(parameterScratch, begin);
+    return true;
 }
 
 
@@ -451,23 +812,23 @@ bool Parser::expectIdentifier(Token * token) {
     return true;
 }
 
-bool Parser::expectType(std::unique_ptr<TypeAST> * type) {
+bool Parser::expectType(const TypeAST ** type) {
     assert(type != nullptr);
     *type = parseType();
     return *type != nullptr;
 }
 
-bool Parser::expectExpression(std::unique_ptr<ExpressionAST> * expression) {
+bool Parser::expectExpression(const ExpressionAST ** expression) {
     assert(expression != nullptr);
     *expression = parseExpression();
     return *expression != nullptr;
 }
 
-bool Parser::eof() const {
-    return index >= tokens.size();
+bool Parser::eof() {
+    return tokens.type(index) == TOK_EOF;
 }
 
-Token Parser::get() const {
+Token Parser::get() {
     assert(!eof());
-    return tokens[index];
+    return tokens.get(index);
 }
\ No newline at end of file
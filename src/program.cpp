@@ -1,7 +1,45 @@
 #include "../include/Program.h"
+#include <algorithm>
 
-Program::Program(std::string & text) : text(text) {}
+Program::Program(std::string_view text) : text(text) {}
 
-std::string Program::extract(const Token & token) const {
-    return text.substr(token.startIndex, token.endIndex - token.startIndex);
+std::string_view Program::source() const {
+    return text;
 }
+
+std::string_view Program::extract(const Token & token) const {
+    return text.substr(token.offset, token.length);
+}
+
+void Program::buildLineStarts() const {
+    std::call_once(lineStartsBuilt, [this] {
+        lineStarts.push_back(0);
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '\n') lineStarts.push_back(i + 1);
+        }
+    });
+}
+
+SourceLocation Program::locate(size_t offset) const {
+    buildLineStarts();
+
+    auto next = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    size_t line = next - lineStarts.begin();
+    return { line, offset - *(next - 1) + 1 };
+}
+
+SourceLocation Program::locate(const Token & token) const {
+    return locate(token.offset);
+}
+
+size_t Program::offset(SourceLocation location) const {
+    buildLineStarts();
+
+    if (location.line == 0) return 0;
+    if (location.line > lineStarts.size()) return text.size();
+
+    size_t lineStart = lineStarts[location.line - 1];
+    size_t lineEnd = location.line < lineStarts.size() ? lineStarts[location.line] - 1 : text.size();
+    size_t column = location.column > 0 ? location.column - 1 : 0;
+    return std::min(lineStart + column, lineEnd);
+}
\ No newline at end of file
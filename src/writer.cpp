@@ -1,41 +1,224 @@
 #include "../include/Writer.h"
+#include <cassert>
+#include <mutex>
+#include <thread>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/MC/TargetRegistry.h>
 #include <llvm/Target/TargetOptions.h>
-#include <llvm/TargetParser/Host.h>
+#include "../include/LLVMVersion.h"
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/PassTimingInfo.h>
+#include <llvm/Pass.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/StandardInstrumentations.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
 
-Writer::Writer(std::shared_ptr<llvm::Module> & llvmModule) : llvmModule(llvmModule) {
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
+// LLVM 15 and older take llvm::Optional
+#if LLVM_VERSION_MAJOR >= 16
+static constexpr auto NO_VALUE = std::nullopt;
+#else
+static constexpr auto NO_VALUE = llvm::None;
+#endif
 
-    auto targetTriple = llvm::sys::getDefaultTargetTriple();
-    llvmModule->setTargetTriple(targetTriple);
+static llvm::CodeGenOptLevel codeGenLevel(Optimization optimization) {
+    switch (optimization) {
+    case OPTIMIZE_NONE:       return llvm::CodeGenOptLevel::None;
+    case OPTIMIZE_LESS:       return llvm::CodeGenOptLevel::Less;
+    case OPTIMIZE_AGGRESSIVE: return llvm::CodeGenOptLevel::Aggressive;
+    default:                  return llvm::CodeGenOptLevel::Default;
+    }
+}
+
+static llvm::OptimizationLevel pipelineLevel(Optimization optimization) {
+    switch (optimization) {
+    case OPTIMIZE_NONE:       return llvm::OptimizationLevel::O0;
+    case OPTIMIZE_LESS:       return llvm::OptimizationLevel::O1;
+    case OPTIMIZE_DEFAULT:    return llvm::OptimizationLevel::O2;
+    case OPTIMIZE_AGGRESSIVE: return llvm::OptimizationLevel::O3;
+    case OPTIMIZE_SIZE:       return llvm::OptimizationLevel::Os;
+    }
+    return llvm::OptimizationLevel::O0;
+}
+
+void OutputOptions::targetHost() {
+    cpu = llvm::sys::getHostCPUName().str();
+
+    // features given with -mattr come last, so they override the host's
+    std::string hostFeatures;
+    llvm::StringMap<bool> available;
+    if (llvm::sys::getHostCPUFeatures(available)) {
+        for (auto & feature : available) {
+            hostFeatures += (feature.getValue() ? "+" : "-") + feature.getKey().str() + ",";
+        }
+    }
+    features = hostFeatures + features;
+    if (!features.empty() && features.back() == ',') features.pop_back();
+}
+
+Writer::Writer(llvm::Module & llvmModule, const OutputOptions & options)
+: llvmModule(llvmModule), options(options) {
+    // writers may be created on several threads, see ObjectCache
+    static std::once_flag targetsInitialized;
+    std::call_once(targetsInitialized, [] {
+        llvm::InitializeAllTargetInfos();
+        llvm::InitializeAllTargets();
+        llvm::InitializeAllTargetMCs();
+        llvm::InitializeAllAsmParsers();
+        llvm::InitializeAllAsmPrinters();
+    });
+
+    targetTriple = llvm::sys::getDefaultTargetTriple();
+    llvmModule.setTargetTriple(targetTriple);
 
     std::string err;
-    auto target = llvm::TargetRegistry::lookupTarget(targetTriple, err);
+    target = llvm::TargetRegistry::lookupTarget(targetTriple, err);
 
     if (target == nullptr) {
         llvm::errs() << err;
         return;
     }
 
-    llvm::TargetOptions options;
-    targetMachine = target->createTargetMachine(
-        targetTriple, "generic", "", options, llvm::Reloc::PIC_
+    targetMachine.reset(createTargetMachine());
+    llvmModule.setDataLayout(targetMachine->createDataLayout());
+}
+
+llvm::TargetMachine * Writer::createTargetMachine() const {
+    llvm::TargetOptions targetOptions;
+    targetOptions.FunctionSections = options.functionSections;
+    targetOptions.DataSections = options.functionSections;
+    return target->createTargetMachine(
+        targetTriple, options.cpu, options.features, targetOptions, llvm::Reloc::PIC_,
+        NO_VALUE, codeGenLevel(options.optimization)
     );
+}
+
+/* Runs the same pipelines as clang at each level. Every level above -O0
+    promotes allocas to registers, inlines and optimizes loops, which
+    matters here since every local the IRGenerator emits lives in an
+    alloca. */
+void Writer::optimize(llvm::Module & llvmModule, llvm::TargetMachine & targetMachine, const OutputOptions & options) {
+    // read by both pass managers, the instrumentation and the code generator,
+    // only written if it changes since partitions are optimized concurrently
+    if (llvm::TimePassesIsEnabled != options.timePasses) {
+        llvm::TimePassesIsEnabled = options.timePasses;
+    }
+
+    // lets the optimizer and vectorizer use everything the target has,
+    // multiversioned functions already name their own
+    auto cpu = targetMachine.getTargetCPU();
+    auto features = targetMachine.getTargetFeatureString();
+    for (auto & function : llvmModule) {
+        if (function.isDeclaration() || function.hasFnAttribute("target-cpu")) continue;
+        function.addFnAttr("target-cpu", cpu);
+        if (!features.empty()) {
+            function.addFnAttr("target-features", features);
+        }
+    }
+
+    llvm::LoopAnalysisManager loopAnalysis;
+    llvm::FunctionAnalysisManager functionAnalysis;
+    llvm::CGSCCAnalysisManager cgsccAnalysis;
+    llvm::ModuleAnalysisManager moduleAnalysis;
+
+    // pass timings are printed when the instrumentation goes out of scope
+    llvm::PassInstrumentationCallbacks callbacks;
+#if LLVM_VERSION_MAJOR >= 17
+    llvm::StandardInstrumentations instrumentation(llvmModule.getContext(), false);
+    instrumentation.registerCallbacks(callbacks, &moduleAnalysis);
+#elif LLVM_VERSION_MAJOR == 16
+    llvm::StandardInstrumentations instrumentation(llvmModule.getContext(), false);
+    instrumentation.registerCallbacks(callbacks, &functionAnalysis);
+#else
+    llvm::StandardInstrumentations instrumentation(false);
+    instrumentation.registerCallbacks(callbacks, &functionAnalysis);
+#endif
+
+    llvm::PassBuilder builder(&targetMachine, llvm::PipelineTuningOptions(), NO_VALUE, &callbacks);
+    builder.registerModuleAnalyses(moduleAnalysis);
+    builder.registerCGSCCAnalyses(cgsccAnalysis);
+    builder.registerFunctionAnalyses(functionAnalysis);
+    builder.registerLoopAnalyses(loopAnalysis);
+    builder.crossRegisterProxies(loopAnalysis, functionAnalysis, cgsccAnalysis, moduleAnalysis);
 
-    llvmModule->setDataLayout(targetMachine->createDataLayout());
+    auto level = pipelineLevel(options.optimization);
+    auto pipeline = level == llvm::OptimizationLevel::O0 ?
+        builder.buildO0DefaultPipeline(level) :
+        builder.buildPerModuleDefaultPipeline(level);
+    pipeline.run(llvmModule, moduleAnalysis);
 }
 
 Error Writer::output(const std::string & filename) {
-    // TODO: optimizer pass
+    optimize(llvmModule, *targetMachine, options);
+    auto err = emit(llvmModule, *targetMachine, options, filename);
 
+    if (options.timePasses) {
+        llvm::reportAndResetTimings(&llvm::errs());
+    }
+
+    return err;
+}
+
+/* Each partition is passed through bitcode into a context of its own, as
+    a context can't be used by two threads at once. Locals are made
+    external so partitions can call each other, but functions in different
+    partitions are never inlined into each other. */
+Error Writer::output(const std::vector<std::string> & filenames) {
+    assert(!filenames.empty());
+    if (filenames.size() == 1) {
+        return output(filenames[0]);
+    }
+
+    std::vector<llvm::SmallString<0>> partitions;
+    llvm::SplitModule(llvmModule, filenames.size(), [&](std::unique_ptr<llvm::Module> partition) {
+        llvm::raw_svector_ostream stream(partitions.emplace_back());
+        llvm::WriteBitcodeToFile(*partition, stream);
+    });
+    assert(partitions.size() == filenames.size());
+
+    std::vector<Error> results(filenames.size(), ERR_NONE);
+    auto compilePartition = [&](size_t i) {
+        llvm::LLVMContext context;
+        auto partition = llvm::parseBitcodeFile(llvm::MemoryBufferRef(partitions[i].str(), filenames[i]), context);
+        if (!partition) {
+            std::cerr << "ERR: could not read back partition " << i << ", " << llvm::toString(partition.takeError()) << std::endl;
+            results[i] = ERR_OUTPUT_OBJECT_FILE;
+            return;
+        }
+
+        std::unique_ptr<llvm::TargetMachine> partitionMachine(createTargetMachine());
+        optimize(**partition, *partitionMachine, options);
+        results[i] = emit(**partition, *partitionMachine, options, filenames[i]);
+    };
+
+    // pass timers are shared, so timed partitions are compiled one at a time
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < filenames.size(); i++) {
+        if (options.timePasses) {
+            compilePartition(i);
+        } else {
+            threads.emplace_back(compilePartition, i);
+        }
+    }
+    compilePartition(0);
+    for (auto & thread : threads) thread.join();
+
+    if (options.timePasses) {
+        llvm::reportAndResetTimings(&llvm::errs());
+    }
+
+    for (auto result : results) {
+        if (result != ERR_NONE) return result;
+    }
+    return ERR_NONE;
+}
+
+Error Writer::emit(llvm::Module & llvmModule, llvm::TargetMachine & targetMachine, const OutputOptions & options, const std::string & filename) {
     std::error_code err;
     llvm::raw_fd_ostream dest(filename, err, llvm::sys::fs::OF_None);
 
@@ -44,15 +227,25 @@ Error Writer::output(const std::string & filename) {
         return ERR_OUTPUT_OBJECT_FILE;
     }
 
+    // what the code generator would have been given
+    if (options.emitLLVM) {
+        llvmModule.print(dest, nullptr);
+        return ERR_NONE;
+    }
+
     llvm::legacy::PassManager pass;
 
-    if (targetMachine->addPassesToEmitFile(pass, dest, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+#if LLVM_VERSION_MAJOR >= 18
+    auto fileType = llvm::CodeGenFileType::ObjectFile;
+#else
+    auto fileType = llvm::CGFT_ObjectFile;
+#endif
+    if (targetMachine.addPassesToEmitFile(pass, dest, nullptr, fileType)) {
         std::cerr << "ERR: can't emit a file of type llvm::CodeGenFileType::ObjectFile" << std::endl;
         return ERR_OUTPUT_OBJECT_FILE;
     }
 
-    pass.run(*llvmModule);
+    pass.run(llvmModule);
     dest.flush();
-
     return ERR_NONE;
 }
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../include/Lexer.h"
+#include "../include/Program.h"
+#include "../include/Scanner.h"
+
+/* Measures lexer throughput in tokens per second with each set of scan
+    kernels, and each kernel on its own against the scalar fallback. Fails
+    only if the kernels disagree, timings are reported and not judged. */
+static const int REPEATS = 5;
+
+struct Width {
+    ScannerWidth width;
+    const char * name;
+};
+
+static const Width WIDTHS[] = {
+    { SCANNER_SCALAR, "scalar" },
+    { SCANNER_SSE2, "sse2" },
+    { SCANNER_AVX2, "avx2" },
+};
+
+using Kernel = const char * (*)(const char *, const char *);
+
+struct Scan {
+    const char * name;
+    Kernel kernel;
+    std::string input;
+};
+
+// the best of a few runs, in seconds
+static double time(const std::function<void()> & run) {
+    double best = 1e30;
+    for (int i = 0; i < REPEATS; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+static std::string repeat(const std::string & text, size_t count) {
+    std::string result;
+    result.reserve(text.size() * count);
+    for (size_t i = 0; i < count; i++) result += text;
+    return result;
+}
+
+// functions like the ones in examples/, with comments, strings and long names
+static std::string program(size_t functions) {
+    std::string text;
+    for (size_t i = 0; i < functions; i++) {
+        auto n = std::to_string(i);
+        text +=
+            "// computes something for function " + n + ", and documents it\n"
+            "fun compute" + n + "(count: int, pixels: * byte): int {\n"
+            "    let total: int = 0;\n"
+            "    let index: int = count - 1;\n"
+            "    while (index >= 0) {\n"
+            "        let next: int = total + (index * 31 + 7) % 255;\n"
+            "        return next;\n"
+            "    }\n"
+            "    printf(\"function " + n + " computed %d\\n\", total);\n"
+            "    return total;\n"
+            "}\n\n";
+    }
+    return text;
+}
+
+static bool lex(const Program & program, TokenBuffer * tokens) {
+    Interner interner;
+    Lexer lexer(program, interner);
+    *tokens = TokenBuffer();
+    return lexer.tokenize(*tokens) == ERR_NONE;
+}
+
+static bool same(const TokenBuffer & left, const TokenBuffer & right) {
+    if (left.size() != right.size()) return false;
+    for (size_t i = 0; i < left.size(); i++) {
+        auto a = left[i], b = right[i];
+        if (a.type != b.type || a.offset != b.offset || a.length != b.length) return false;
+    }
+    return true;
+}
+
+int main() {
+    std::cout << std::fixed << std::setprecision(1);
+    int failures = 0;
+
+    // ---- the whole lexer ----
+    std::string text = program(20000);
+    Program source(text);
+    double megabytes = text.size() / 1e6;
+
+    TokenBuffer expected;
+    selectScanner(SCANNER_SCALAR);
+    if (!lex(source, &expected)) {
+        std::cerr << "ERR: the benchmark program failed to lex" << std::endl;
+        return 1;
+    }
+
+    double scalarSeconds = 0;
+    for (auto & width : WIDTHS) {
+        if (!selectScanner(width.width)) {
+            std::cout << "lexer, " << width.name << ": not supported on this host" << std::endl;
+            continue;
+        }
+
+        TokenBuffer tokens;
+        double seconds = time([&] { lex(source, &tokens); });
+        if (width.width == SCANNER_SCALAR) scalarSeconds = seconds;
+
+        std::cout << "lexer, " << width.name << ": " << expected.size() / seconds / 1e6 << "M tokens/s, " <<
+            megabytes / seconds << " MB/s, x" << std::setprecision(2) << scalarSeconds / seconds <<
+            std::setprecision(1) << " scalar" << std::endl;
+
+        if (!same(tokens, expected)) {
+            std::cerr << "ERR: the " << width.name << " scanner lexes differently from the scalar one" << std::endl;
+            failures++;
+        }
+    }
+
+    // ---- each kernel on a run it has to scan to the end ----
+    const size_t SIZE = 1 << 24;
+    Scan scans[] = {
+        { "scanWhitespace", scanWhitespace, repeat(" \t  \r\n", SIZE / 6) + "x" },
+        { "scanNewline", scanNewline, repeat("a comment ", SIZE / 10) + "\n" },
+        { "scanQuoteOrNewline", scanQuoteOrNewline, repeat("some text ", SIZE / 10) + "\"" },
+        { "scanAlphanumeric", scanAlphanumeric, repeat("Identifier0", SIZE / 11) + " " },
+    };
+
+    for (auto & scan : scans) {
+        const char * begin = scan.input.data();
+        const char * end = begin + scan.input.size();
+        double gigabytes = scan.input.size() / 1e9;
+
+        std::cout << scan.name << ":";
+        scalarSeconds = 0;
+        for (auto & width : WIDTHS) {
+            if (!selectScanner(width.width)) continue;
+
+            const char * stop = nullptr;
+            double seconds = time([&] { stop = scan.kernel(begin, end); });
+            if (width.width == SCANNER_SCALAR) scalarSeconds = seconds;
+
+            std::cout << " " << width.name << " " << gigabytes / seconds << " GB/s (x" <<
+                std::setprecision(2) << scalarSeconds / seconds << std::setprecision(1) << ")";
+
+            if (stop != end - 1) {
+                std::cerr << std::endl << "ERR: " << scan.name << " with " << width.name <<
+                    " stopped at byte " << stop - begin << " of " << scan.input.size() - 1 << std::endl;
+                failures++;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/MC/MCAsmInfo.h>
+#include <llvm/MC/MCContext.h>
+#include <llvm/MC/MCDisassembler/MCDisassembler.h>
+#include <llvm/MC/MCInst.h>
+#include <llvm/MC/MCInstPrinter.h>
+#include <llvm/MC/MCInstrInfo.h>
+#include <llvm/MC/MCRegisterInfo.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/MCTargetOptions.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include "../include/LLVMVersion.h"
+#include "../include/Lexer.h"
+#include "../include/Parser.h"
+#include "../include/Analyzer.h"
+#include "../include/IRGenerator.h"
+#include "../include/Writer.h"
+
+/* Compiles programs for x86-64 and disassembles what was emitted, so the
+    instructions are checked rather than the attributes asking for them.
+    Each instruction is given the lowest x86-64 feature level that has it,
+    from its encoding and its name. */
+
+// runtime/cpu.cpp, levels numbered as Level is
+extern "C" int calcium_cpu_level();
+
+enum Level {
+    LEVEL_BASELINE,
+    LEVEL_V2, // SSE3, SSSE3, SSE4.1, SSE4.2, POPCNT, CMPXCHG16B, LAHF
+    LEVEL_V3, // AVX, AVX2, BMI1, BMI2, F16C, FMA, LZCNT, MOVBE
+    LEVEL_V4, // AVX-512
+    LEVEL_NONE, // in no level, e.g. AES, so never in a multiversioned function
+};
+
+static const char * const LEVEL_NAMES[] = { "x86-64", "x86-64-v2", "x86-64-v3", "x86-64-v4", "no level" };
+
+// by name, those whose encoding doesn't tell
+static const std::map<std::string, Level> NAMED_LEVELS = {
+    { "addsubpd", LEVEL_V2 }, { "addsubps", LEVEL_V2 }, { "haddpd", LEVEL_V2 }, { "haddps", LEVEL_V2 },
+    { "hsubpd", LEVEL_V2 }, { "hsubps", LEVEL_V2 }, { "lddqu", LEVEL_V2 }, { "movddup", LEVEL_V2 },
+    { "movshdup", LEVEL_V2 }, { "movsldup", LEVEL_V2 }, { "fisttp", LEVEL_V2 }, { "popcnt", LEVEL_V2 },
+    { "cmpxchg16b", LEVEL_V2 }, { "lahf", LEVEL_V2 }, { "sahf", LEVEL_V2 },
+    // tzcnt is left out, older CPUs run it as bsf and it's only emitted where they agree
+    { "lzcnt", LEVEL_V3 }, { "movbe", LEVEL_V3 },
+    { "aesenc", LEVEL_NONE }, { "aesenclast", LEVEL_NONE }, { "aesdec", LEVEL_NONE },
+    { "aesdeclast", LEVEL_NONE }, { "pclmulqdq", LEVEL_NONE }, { "sha1rnds4", LEVEL_NONE },
+    { "sha256rnds2", LEVEL_NONE }, { "adcx", LEVEL_NONE }, { "adox", LEVEL_NONE },
+    { "rdrand", LEVEL_NONE }, { "rdseed", LEVEL_NONE },
+};
+
+static Level levelOf(llvm::ArrayRef<uint8_t> bytes, const std::string & mnemonic) {
+    auto named = NAMED_LEVELS.find(mnemonic);
+    if (named != NAMED_LEVELS.end()) return named->second;
+
+    // legacy and REX prefixes
+    size_t i = 0;
+    while (i < bytes.size() && (bytes[i] == 0x26 || bytes[i] == 0x2E || bytes[i] == 0x36 || bytes[i] == 0x3E ||
+        bytes[i] == 0x64 || bytes[i] == 0x65 || bytes[i] == 0x66 || bytes[i] == 0x67 ||
+        bytes[i] == 0xF0 || bytes[i] == 0xF2 || bytes[i] == 0xF3 || (bytes[i] & 0xF0) == 0x40)) {
+        i++;
+    }
+    if (i == bytes.size()) return LEVEL_BASELINE;
+
+    // in 64-bit mode 0x62 is always EVEX and 0xC4 and 0xC5 always VEX
+    if (bytes[i] == 0x62) return LEVEL_V4;
+    if (bytes[i] == 0xC4 || bytes[i] == 0xC5) return LEVEL_V3;
+    // the three-byte opcode maps have nothing below SSSE3
+    if (bytes[i] == 0x0F && i + 1 < bytes.size() && (bytes[i + 1] == 0x38 || bytes[i + 1] == 0x3A)) return LEVEL_V2;
+    return LEVEL_BASELINE;
+}
+
+struct Instruction {
+    Level level;
+    std::string text;
+};
+
+// the instructions of every function, by symbol
+typedef std::map<std::string, std::vector<Instruction>> Disassembly;
+
+static bool compile(const std::string & source, const OutputOptions & options, const std::string & filename) {
+    Program program(source);
+    Interner interner;
+    Lexer lexer(program, interner);
+    TokenStream tokens(lexer);
+    Arena arena;
+    Parser parser(program, tokens, arena);
+    std::vector<const AST *> ast;
+    if (parser.parse(ast) != ERR_NONE) return false;
+
+    TypeTable types;
+    Analyzer analyzer(program, interner, types);
+    if (analyzer.analyze(ast, 1) != ERR_NONE) return false;
+
+    llvm::LLVMContext llvmContext;
+    llvm::Module llvmModule("Calcium", llvmContext);
+    IRGenerator irGenerator(program, interner, types, llvmContext, llvmModule);
+    irGenerator.generate(ast);
+
+    Writer writer(llvmModule, options);
+    return writer.output(filename) == ERR_NONE;
+}
+
+static bool disassemble(const std::string & filename, Disassembly * disassembly) {
+    auto object = llvm::object::ObjectFile::createObjectFile(filename);
+    if (!object) {
+        llvm::errs() << "ERR: could not read \"" << filename << "\", " << object.takeError() << "\n";
+        return false;
+    }
+    auto & file = *object->getBinary();
+
+    std::string err;
+    auto triple = file.makeTriple();
+    auto target = llvm::TargetRegistry::lookupTarget(triple.str(), err);
+    if (target == nullptr) {
+        std::cerr << "ERR: " << err << std::endl;
+        return false;
+    }
+
+    llvm::MCTargetOptions targetOptions;
+    std::unique_ptr<llvm::MCRegisterInfo> registers(target->createMCRegInfo(triple.str()));
+    std::unique_ptr<llvm::MCAsmInfo> asmInfo(target->createMCAsmInfo(*registers, triple.str(), targetOptions));
+    std::unique_ptr<llvm::MCSubtargetInfo> subtarget(target->createMCSubtargetInfo(triple.str(), "", ""));
+    std::unique_ptr<llvm::MCInstrInfo> instructions(target->createMCInstrInfo());
+    llvm::MCContext context(triple, asmInfo.get(), registers.get(), subtarget.get());
+    std::unique_ptr<llvm::MCDisassembler> disassembler(target->createMCDisassembler(*subtarget, context));
+    // Intel syntax, mnemonics without size suffixes
+    std::unique_ptr<llvm::MCInstPrinter> printer(target->createMCInstPrinter(triple, 1, *asmInfo, *instructions, *registers));
+    if (disassembler == nullptr || printer == nullptr) {
+        std::cerr << "ERR: no disassembler for " << triple.str() << std::endl;
+        return false;
+    }
+
+    for (auto & sized : llvm::object::computeSymbolSizes(file)) {
+        auto & symbol = sized.first;
+        auto type = symbol.getType();
+        auto name = symbol.getName();
+        auto address = symbol.getAddress();
+        auto section = symbol.getSection();
+        if (!type || !name || !address || !section) {
+            llvm::consumeError(type.takeError());
+            llvm::consumeError(name.takeError());
+            llvm::consumeError(address.takeError());
+            llvm::consumeError(section.takeError());
+            continue;
+        }
+        if (*type != llvm::object::SymbolRef::ST_Function || *section == file.section_end()) continue;
+
+        auto contents = (*section)->getContents();
+        if (!contents) {
+            llvm::consumeError(contents.takeError());
+            continue;
+        }
+        auto start = *address - (*section)->getAddress();
+        llvm::ArrayRef<uint8_t> code(reinterpret_cast<const uint8_t *>(contents->data()) + start, sized.second);
+
+        auto & function = (*disassembly)[name->str()];
+        uint64_t size;
+        for (uint64_t offset = 0; offset < code.size(); offset += size) {
+            llvm::MCInst instruction;
+            if (disassembler->getInstruction(instruction, size, code.slice(offset), offset, llvm::nulls()) !=
+                llvm::MCDisassembler::Success) {
+                std::cerr << "ERR: could not disassemble " << name->str() << " at " << offset << std::endl;
+                return false;
+            }
+
+            std::string text;
+            llvm::raw_string_ostream stream(text);
+            printer->printInst(&instruction, offset, "", *subtarget, stream);
+            stream.flush();
+
+            // the first word, after any rep or lock prefix
+            std::string mnemonic;
+            size_t begin = 0;
+            do {
+                begin = text.find_first_not_of(" \t", begin + mnemonic.size());
+                size_t end = text.find_first_of(" \t", begin);
+                mnemonic = begin == std::string::npos ? "" : text.substr(begin, end - begin);
+            } while (mnemonic == "rep" || mnemonic == "repne" || mnemonic == "lock");
+
+            auto first = text.find_first_not_of(" \t");
+            function.push_back({ levelOf(code.slice(offset, size), mnemonic), first == std::string::npos ? "" : text.substr(first) });
+        }
+    }
+    return true;
+}
+
+static bool compileAndDisassemble(const std::string & source, const OutputOptions & options, Disassembly * disassembly) {
+    llvm::SmallString<128> filename;
+    if (auto created = llvm::sys::fs::createTemporaryFile("calcium", "o", filename)) {
+        std::cerr << "ERR: could not create a temporary object, " << created.message() << std::endl;
+        return false;
+    }
+    llvm::FileRemover remover(filename);
+    return compile(source, options, std::string(filename)) && disassemble(std::string(filename), disassembly);
+}
+
+// the highest level of any instruction in function, printing those above limit
+static Level highest(const Disassembly & disassembly, const std::string & function, Level limit) {
+    Level level = LEVEL_BASELINE;
+    for (auto & instruction : disassembly.at(function)) {
+        if (instruction.level > limit) {
+            std::cerr << "ERR: " << function << " has " << instruction.text << ", from " << LEVEL_NAMES[instruction.level] << std::endl;
+        }
+        level = std::max(level, instruction.level);
+    }
+    return level;
+}
+
+// --------------------- MULTIVERSIONING ---------------------
+/* Every version of a multiversioned function only uses its own level's
+    instructions, even compiled with -march=native for a newer CPU. The
+    generic version, the thunk and the dispatch only use the baseline. */
+static const char * const SHIFTS =
+    "@multiversion\n"
+    "fun shifts(x: int, y: int): int {\n"
+    "    return (x << y) + (x >> (y - 1)) * y;\n"
+    "}\n"
+    "\n"
+    "fun main(): int {\n"
+    "    return shifts(7, 20);\n"
+    "}\n";
+
+static int checkMultiversioning() {
+    OutputOptions options;
+    options.optimization = OPTIMIZE_DEFAULT;
+    options.targetHost();
+
+    Disassembly disassembly;
+    if (!compileAndDisassemble(SHIFTS, options, &disassembly)) return 1;
+
+    struct Version {
+        const char * function;
+        Level level;
+    };
+    const Version versions[] = {
+        { "shifts.default", LEVEL_BASELINE },
+        { "shifts", LEVEL_BASELINE },
+        { "calcium.dispatch", LEVEL_BASELINE },
+        { "shifts.x86-64-v2", LEVEL_V2 },
+        { "shifts.x86-64-v3", LEVEL_V3 },
+        { "shifts.x86-64-v4", LEVEL_V4 },
+    };
+
+    int failures = 0;
+    for (auto & version : versions) {
+        if (disassembly.count(version.function) == 0) {
+            std::cerr << "ERR: no function " << version.function << " in the object" << std::endl;
+            failures++;
+            continue;
+        }
+        auto level = highest(disassembly, version.function, version.level);
+        std::cout << version.function << ": " << disassembly.at(version.function).size() <<
+            " instructions, up to " << LEVEL_NAMES[level] << std::endl;
+        if (level > version.level) failures++;
+    }
+
+    // variable shifts are BMI2's shlx and sarx from x86-64-v3 on, so the check can see them
+    for (auto function : { "shifts.x86-64-v3", "shifts.x86-64-v4" }) {
+        if (disassembly.count(function) != 0 && highest(disassembly, function, LEVEL_NONE) < LEVEL_V3) {
+            std::cerr << "ERR: " << function << " has no x86-64-v3 instruction, its features were not applied" << std::endl;
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// --------------------- TARGET OPTIONS ---------------------
+/* -mcpu, -mattr and -march=native change the instructions selected, not
+    only the attributes asking for them. Variable shifts are BMI2's shlx
+    and sarx when it is available, and shl and sar otherwise. */
+static const char * const PLAIN_SHIFTS =
+    "fun shifts(x: int, y: int): int {\n"
+    "    return (x << y) + (x >> (y - 1)) * y;\n"
+    "}\n";
+
+struct Target {
+    const char * flags;
+    std::string cpu;
+    std::string features;
+    bool host;
+};
+
+static Level highest(const std::vector<Instruction> & instructions) {
+    auto level = LEVEL_BASELINE;
+    for (auto & instruction : instructions) level = std::max(level, instruction.level);
+    return level;
+}
+
+static bool compileTarget(const Target & target, std::vector<Instruction> * instructions) {
+    OutputOptions options;
+    options.optimization = OPTIMIZE_DEFAULT;
+    options.features = target.features;
+    if (target.host) options.targetHost();
+    if (!target.cpu.empty()) options.cpu = target.cpu;
+
+    Disassembly disassembly;
+    if (!compileAndDisassemble(PLAIN_SHIFTS, options, &disassembly) || disassembly.count("shifts") == 0) {
+        std::cerr << "ERR: could not compile shifts with " << target.flags << std::endl;
+        return false;
+    }
+    *instructions = disassembly.at("shifts");
+    std::cout << target.flags << ": " << instructions->size() << " instructions, up to " <<
+        LEVEL_NAMES[highest(*instructions)] << std::endl;
+    return true;
+}
+
+static int checkTargetOptions() {
+    std::vector<Instruction> none, generic, bmi2, native, nativeWithout;
+    if (!compileTarget({ "no flags", "", "", false }, &none) ||
+        !compileTarget({ "-mcpu=x86-64", "x86-64", "", false }, &generic) ||
+        !compileTarget({ "-mcpu=x86-64 -mattr=+bmi2", "x86-64", "+bmi2", false }, &bmi2) ||
+        !compileTarget({ "-march=native", "", "", true }, &native) ||
+        !compileTarget({ "-march=native -mattr=-bmi2", "", "-bmi2", true }, &nativeWithout)) {
+        return 1;
+    }
+
+    int failures = 0;
+    auto expect = [&](bool condition, const char * message) {
+        if (!condition) {
+            std::cerr << "ERR: " << message << std::endl;
+            failures++;
+        }
+    };
+
+    expect(highest(none) == LEVEL_BASELINE, "no flags used more than the x86-64 baseline");
+    expect(highest(generic) == LEVEL_BASELINE, "-mcpu=x86-64 used more than the x86-64 baseline");
+    expect(highest(bmi2) == LEVEL_V3, "-mattr=+bmi2 did not select shlx or sarx");
+    expect(highest(nativeWithout) < LEVEL_V3, "-mattr=-bmi2 did not override -march=native");
+
+    // the host decides what -march=native may use
+    if (calcium_cpu_level() >= LEVEL_V3) {
+        expect(highest(native) >= LEVEL_V3, "-march=native selected the same instructions as the baseline on an x86-64-v3 host");
+    } else {
+        std::cout << "-march=native: the host is below x86-64-v3, only checked against its level" << std::endl;
+    }
+    expect(highest(native) <= Level(calcium_cpu_level()), "-march=native used instructions above the host's level");
+    return failures;
+}
+
+int main() {
+    llvm::Triple triple(llvm::sys::getDefaultTargetTriple());
+    if (triple.getArch() != llvm::Triple::x86_64 || !triple.isOSBinFormatELF()) {
+        std::cout << "not an x86-64 ELF target, skipped" << std::endl;
+        return 0;
+    }
+
+    // the Writer initializes the rest
+    llvm::InitializeAllDisassemblers();
+
+    int failures = checkMultiversioning() + checkTargetOptions();
+    return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
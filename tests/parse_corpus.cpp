@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../include/Lexer.h"
+#include "../include/Parser.h"
+#include "../include/SourceBuffer.h"
+
+/* Lexes and parses the files in tests/corpus, inputs that made the old
+    trial-and-rewind parser repeat work. Files starting "// expect: error"
+    must fail to parse, all others must parse. Each file is timed per token
+    against ordinary.ca, and fails if it costs far more than ordinary code.
+    Tokens rather than bytes, "f(f(f(" is dense and costs more per byte at
+    any depth. The fixed cost of setting up a parse is measured on an empty
+    file and left out, the small files would be dominated by it. */
+static const double LIMIT = 10.0;
+// files are parsed repeatedly for at least this long, they are small
+static const double MIN_TIME = 0.05;
+
+struct Result {
+    bool parsed;
+    std::string diagnostics;
+};
+
+// lexing and parsing interleave, as in the compiler
+static Result parse(const Program & program) {
+    Interner interner;
+    Arena arena;
+    std::vector<const AST *> ast;
+    std::stringstream diagnostics;
+
+    Lexer lexer(program, interner, diagnostics);
+    TokenStream tokens(lexer);
+    Parser parser(program, tokens, arena, diagnostics);
+    bool parsed = parser.parse(ast) == ERR_NONE;
+    return { parsed, diagnostics.str() };
+}
+
+static size_t countTokens(const Program & program) {
+    Interner interner;
+    std::stringstream diagnostics;
+    Lexer lexer(program, interner, diagnostics);
+    TokenBuffer tokens;
+    lexer.tokenize(tokens);
+    return tokens.size();
+}
+
+// seconds per parse, the best of as many as fit in MIN_TIME
+static double time(const Program & program) {
+    double best = 1e30, total = 0;
+    for (int runs = 0; runs < 3 || total < MIN_TIME; runs++) {
+        auto start = std::chrono::steady_clock::now();
+        parse(program);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+        total += elapsed.count();
+    }
+    return best;
+}
+
+static bool endsWith(const std::string & text, const std::string & suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int main(int argc, char ** argv) {
+    std::vector<std::string> filenames(argv + 1, argv + argc);
+    auto baseline = std::find_if(filenames.begin(), filenames.end(),
+        [](const std::string & filename) { return endsWith(filename, "ordinary.ca"); });
+    if (baseline == filenames.end()) {
+        std::cerr << "ERR: expected the corpus files, including ordinary.ca, e.g. ParseCorpus tests/corpus/*.ca" << std::endl;
+        return 1;
+    }
+
+    // the baseline first, the others are compared to it
+    std::rotate(filenames.begin(), baseline, baseline + 1);
+
+    std::string empty;
+    double setup = time(Program(empty));
+
+    int failures = 0;
+    double baselineCost = 0;
+    for (auto & filename : filenames) {
+        SourceBuffer source;
+        if (source.open(filename) != ERR_NONE) return 1;
+        Program program(source.text());
+
+        bool expectError = program.source().rfind("// expect: error", 0) == 0;
+        auto result = parse(program);
+        if (result.parsed == expectError) {
+            std::cerr << "ERR: " << filename << (expectError ? " parsed, but should not" : " failed to parse") << std::endl;
+            std::cerr << result.diagnostics;
+            failures++;
+            continue;
+        }
+
+        double seconds = time(program) - setup;
+        if (seconds <= 0) {
+            std::cout << filename << ": " << countTokens(program) << " tokens, too fast to measure" << std::endl;
+            continue;
+        }
+
+        size_t tokens = countTokens(program);
+        double cost = seconds / tokens;
+        if (baselineCost == 0) baselineCost = cost;
+
+        std::cout << filename << ": " << tokens << " tokens, " <<
+            tokens / seconds / 1e6 << "M tokens/s, x" << cost / baselineCost <<
+            " the cost per token of ordinary code" << std::endl;
+
+        if (cost > LIMIT * baselineCost) {
+            std::cerr << "ERR: " << filename << " costs more than " << LIMIT << " times ordinary code per token" << std::endl;
+            failures++;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
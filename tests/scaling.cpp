@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../include/Lexer.h"
+#include "../include/Parser.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define HAS_PEAK_STACK
+#endif
+
+/* Lexes and parses generated worst cases at two sizes and fails if the
+    larger one, with FACTOR times the input, takes much more than FACTOR
+    times as long. Linear passes scale by FACTOR, quadratic ones by its
+    square, so the limit sits in between. The stack must not grow at all,
+    past a little slack, recursion bounded by the nesting depth uses the
+    same amount at both sizes. */
+static const size_t UNITS = 1 << 15;
+static const size_t FACTOR = 4;
+static const double LIMIT = 2.0 * FACTOR;
+static const int REPEATS = 5;
+// below this the clock is too coarse to compare, e.g. parsing a lone string
+static const double MIN_TIME = 1.0;
+static const size_t STACK_SLACK = 16 << 10;
+// far more than bounded recursion needs, unbounded recursion still overflows it
+static const size_t STACK_SIZE = 64 << 20;
+
+struct Input {
+    const char * name;
+    std::function<std::string(size_t)> generate;
+};
+
+// the best of a few runs, which is the least disturbed by the machine
+static double time(const std::function<void()> & run) {
+    double best = 1e30;
+    for (int i = 0; i < REPEATS; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+#ifdef HAS_PEAK_STACK
+static void * runOnThread(void * run) {
+    (*static_cast<const std::function<void()> *>(run))();
+    return nullptr;
+}
+
+/* The most stack run used, in bytes. It runs on a thread whose stack is
+    filled with a pattern first, stacks grow down, so the lowest byte no
+    longer holding the pattern marks the peak. */
+static size_t peakStack(const std::function<void()> & run) {
+    const uint8_t PATTERN = 0xA5;
+    std::vector<uint8_t> stack(STACK_SIZE, PATTERN);
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstack(&attributes, stack.data(), stack.size());
+    pthread_t thread;
+    pthread_create(&thread, &attributes, runOnThread, const_cast<std::function<void()> *>(&run));
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attributes);
+
+    size_t untouched = 0;
+    while (untouched < stack.size() && stack[untouched] == PATTERN) untouched++;
+    return stack.size() - untouched;
+}
+#endif
+
+struct Timing {
+    double lexer;
+    double parser;
+    size_t stack; // bytes, lexing and parsing once as the compiler does, 0 if not measured
+};
+
+static bool measure(const std::string & text, Timing * timing) {
+    Program program(text);
+    bool success = true;
+
+    timing->stack = 0;
+#ifdef HAS_PEAK_STACK
+    timing->stack = peakStack([&] {
+        Interner interner;
+        Arena arena;
+        std::vector<const AST *> ast;
+        std::stringstream diagnostics;
+        Lexer lexer(program, interner, diagnostics);
+        TokenStream tokens(lexer);
+        Parser parser(program, tokens, arena, diagnostics);
+        success = parser.parse(ast) == ERR_NONE && success;
+    });
+#endif
+
+    timing->lexer = time([&] {
+        Interner interner;
+        TokenBuffer tokens;
+        Lexer lexer(program, interner);
+        success = success && lexer.tokenize(tokens) == ERR_NONE;
+    });
+
+    Interner interner;
+    TokenBuffer tokens;
+    Lexer lexer(program, interner);
+    lexer.tokenize(tokens);
+
+    timing->parser = time([&] {
+        Arena arena;
+        std::vector<const AST *> ast;
+        std::stringstream diagnostics;
+        TokenStream stream(tokens, 0, tokens.size());
+        Parser parser(program, stream, arena, diagnostics);
+        if (parser.parse(ast) != ERR_NONE) {
+            std::cerr << diagnostics.str();
+            success = false;
+        }
+    });
+
+    return success;
+}
+
+static std::string repeat(const std::string & text, size_t count) {
+    std::string result;
+    result.reserve(text.size() * count);
+    for (size_t i = 0; i < count; i++) result += text;
+    return result;
+}
+
+int main() {
+    const Input inputs[] = {
+        { "comment lines", [](size_t n) {
+            return repeat("// a comment on a line of its own\n", n) + "fun f(): int { return 0; }\n";
+        }},
+        { "long string", [](size_t n) {
+            return "fun s(): * byte { return \"" + repeat("some text ", 8 * n) + "\"; }\n";
+        }},
+        { "parameter list", [](size_t n) {
+            std::string text = "fun f(";
+            for (size_t i = 0; i < n; i++) {
+                text += (i > 0 ? ", p" : "p") + std::to_string(i) + ": int";
+            }
+            return text + "): int;\n";
+        }},
+        { "operator chain", [](size_t n) {
+            return "fun f(x: int): int { return x" + repeat(" + x * 2", n) + "; }\n";
+        }},
+        { "prefix run", [](size_t n) {
+            return "fun f(x: int): int { return " + repeat("-!", n) + "x; }\n";
+        }},
+        { "pointer types", [](size_t n) {
+            // as deep as the parser allows, as many times as it takes
+            size_t depth = Parser::MAX_NESTING_DEPTH;
+            std::string type = repeat("*", depth) + "int";
+            std::string text = "fun f(";
+            for (size_t i = 0; i < n / depth; i++) {
+                text += (i > 0 ? ", p" : "p") + std::to_string(i) + ": " + type;
+            }
+            return text + "): " + type + ";\n";
+        }},
+        { "deep nesting", [](size_t n) {
+            // as deep as the parser allows, as many times as it takes
+            size_t depth = Parser::MAX_NESTING_DEPTH - 2;
+            std::string body = repeat("while (x < 1) { ", depth) + repeat("} ", depth);
+            std::string parentheses = repeat("(", depth) + "x" + repeat(")", depth);
+            std::string text;
+            for (size_t i = 0; i < n / depth; i++) {
+                text += "fun f" + std::to_string(i) + "(x: int): int { " + body + "return " + parentheses + "; }\n";
+            }
+            return text;
+        }},
+    };
+
+    int failures = 0;
+    for (auto & input : inputs) {
+        Timing small, large;
+        if (!measure(input.generate(UNITS), &small) || !measure(input.generate(UNITS * FACTOR), &large)) {
+            std::cerr << "ERR: " << input.name << " failed to parse" << std::endl;
+            failures++;
+            continue;
+        }
+
+        double lexerRatio = large.lexer < MIN_TIME ? 1 : large.lexer / small.lexer;
+        double parserRatio = large.parser < MIN_TIME ? 1 : large.parser / small.parser;
+        std::cout << input.name << ": lexer " << small.lexer << "ms -> " << large.lexer << "ms (x" << lexerRatio <<
+            "), parser " << small.parser << "ms -> " << large.parser << "ms (x" << parserRatio << "), stack " <<
+            small.stack << " -> " << large.stack << " bytes" << std::endl;
+
+        if (lexerRatio > LIMIT || parserRatio > LIMIT) {
+            std::cerr << "ERR: " << input.name << " grows faster than its input, x" << FACTOR <<
+                " the input took x" << std::max(lexerRatio, parserRatio) << " the time" << std::endl;
+            failures++;
+        }
+        if (large.stack > small.stack + STACK_SLACK) {
+            std::cerr << "ERR: " << input.name << " uses more stack the longer it is, " <<
+                small.stack << " bytes -> " << large.stack << " bytes" << std::endl;
+            failures++;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
\ No newline at end of file